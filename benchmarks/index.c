@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define REFLECT_IMPLEMENTATION
+#define REFLECT_POSIX
+#include "../reflect.h"
+
+#define FILE_COUNT      256
+#define FUNCTION_COUNT  200
+#define QUERY_COUNT     1000
+
+static char directory[] = "/tmp/reflect_index_bench_XXXXXX";
+
+static double time_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+static void path_make(char* path, size_t size, size_t file) {
+  snprintf(path, size, "%s/file_%zu.c", directory, file);
+}
+
+static bool file_generate(size_t file, size_t variant) {
+  char path[256];
+  path_make(path, sizeof(path), file);
+  FILE* stream = fopen(path, "w");
+  if (!stream) {
+    return false;
+  }
+
+  fprintf(stream, "struct Type_%zu {\n  int field_%zu;\n  struct Type_%zu* next;\n};\n\n", file, variant, (file + 1) % FILE_COUNT);
+  for (size_t i = 0; i < FUNCTION_COUNT; ++i) {
+    fprintf(
+      stream,
+      "int function_%zu_%zu(struct Type_%zu* value, int count) {\n"
+      "  for (int i = 0; i < count; ++i) {\n"
+      "    value->field_%zu += shared_helper(value->next, i) * %zu;\n"
+      "  }\n"
+      "  return value->field_%zu;\n"
+      "}\n\n",
+      file, i, file, variant, i, variant
+    );
+  }
+  return fclose(stream) == 0;
+}
+
+static bool files_update(ReflectIndex* index) {
+  char path[256];
+  for (size_t file = 0; file < FILE_COUNT; ++file) {
+    path_make(path, sizeof(path), file);
+    if (!reflect_index_file_update(index, path)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static volatile uint64_t sink;
+
+static void query_benchmark(const char* path, const char* symbol) {
+  ReflectIndexView view;
+  if (!reflect_index_view_open(&view, path)) {
+    fprintf(stderr, "could not open the index\n");
+    return;
+  }
+
+  uint64_t count = 0;
+  double   start = time_now();
+  for (size_t i = 0; i < QUERY_COUNT; ++i) {
+    ReflectIndexIterator iterator;
+    ReflectIndexPosting  posting;
+    count = 0;
+    reflect_index_view_find(&view, symbol, &iterator);
+    while (reflect_index_iterator_next(&iterator, &posting)) {
+      count++;
+      sink = posting.file + posting.location.line;
+    }
+  }
+  double elapsed = time_now() - start;
+
+  printf("  query    %8.2f us (%-14s %llu postings)\n", elapsed * 1e6 / QUERY_COUNT, symbol, (unsigned long long)count);
+  reflect_index_view_close(&view);
+}
+
+int main(void) {
+  if (!mkdtemp(directory)) {
+    perror("mkdtemp");
+    return 1;
+  }
+
+  char index_path[256];
+  snprintf(index_path, sizeof(index_path), "%s/index.rflidx", directory);
+
+  size_t source_size = 0;
+  for (size_t file = 0; file < FILE_COUNT; ++file) {
+    if (!file_generate(file, 0)) {
+      fprintf(stderr, "could not generate the benchmark files\n");
+      return 1;
+    }
+    char path[256];
+    struct stat info;
+    path_make(path, sizeof(path), file);
+    stat(path, &info);
+    source_size += (size_t)info.st_size;
+  }
+
+  ReflectIndex index;
+  reflect_index_init(&index);
+
+  double start = time_now();
+  bool   built = files_update(&index);
+  double build = time_now() - start;
+
+  start = time_now();
+  bool   written = built && reflect_index_write(&index, index_path);
+  double write   = time_now() - start;
+  if (!written) {
+    fprintf(stderr, "could not build the index\n");
+    return 1;
+  }
+
+  // Change one file, the update only lexes that one again but the write still rebuilds every posting list.
+  file_generate(FILE_COUNT / 2, 1);
+  start = time_now();
+  bool   updated = files_update(&index);
+  double update  = time_now() - start;
+  updated        = updated && reflect_index_write(&index, index_path);
+  double rewrite = time_now() - start;
+  if (!updated) {
+    fprintf(stderr, "could not update the index\n");
+    return 1;
+  }
+
+  struct stat info;
+  stat(index_path, &info);
+  printf("Index (%d files, %zu source bytes, %lld index bytes):\n", FILE_COUNT, source_size, (long long)info.st_size);
+  printf("  build    %8.2f ms\n", build * 1e3);
+  printf("  write    %8.2f ms\n", write * 1e3);
+  printf("  update   %8.2f ms (1 changed file, %.2f ms with the write)\n", update * 1e3, rewrite * 1e3);
+  query_benchmark(index_path, "shared_helper");
+  query_benchmark(index_path, "Type_7");
+  query_benchmark(index_path, "missing_symbol");
+
+  reflect_index_free(&index);
+  for (size_t file = 0; file < FILE_COUNT; ++file) {
+    char path[256];
+    path_make(path, sizeof(path), file);
+    remove(path);
+  }
+  remove(index_path);
+  remove(directory);
+  return 0;
+}
@@ -0,0 +1,221 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define REFLECT_IMPLEMENTATION
+#include "../reflect.h"
+
+#define SOURCE_SIZE (16u * 1024u * 1024u)
+#define RUN_COUNT   5
+
+typedef bool (*LexerEngine)(ReflectLexer* lexer, ReflectToken* token);
+
+static double time_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+// Builds a C like source out of declarations and function bodies, using only what the lexer accepts.
+static char* source_generate(size_t size) {
+  static const char* fragments[] = {
+    "struct Vector",
+    " {\n  int x;\n  unsigned long long y;\n  char* name;\n};\n\n",
+    "static int vector_dot(struct Vector* a, struct Vector* b) {\n",
+    "  if (a->x <= b->x && a->y >= b->y || !a->name) {\n    return 0x7fffffff;\n  }\n",
+    "  for (int i = 0; i < 1024; ++i) {\n    a->x += b->x * i >> 2;\n    b->y -= 017 ^ i;\n  }\n",
+    "  a->x <<= 3; b->y >>= 1; a->x |= b->x != 0 ? 1u : 2ull;\n",
+    "  return a->x * b->x + a->y * b->y % 100;\n}\n\n",
+  };
+  const size_t fragment_count = sizeof(fragments) / sizeof(fragments[0]);
+
+  char*  source = malloc(size + 1);
+  size_t length = 0;
+  size_t index  = 0;
+  while (source) {
+    const char* fragment = fragments[index++ % fragment_count];
+    size_t      count    = strlen(fragment);
+    if (length + count > size) {
+      break;
+    }
+    memcpy(source + length, fragment, count);
+    length += count;
+  }
+  if (source) {
+    source[length] = '\0';
+  }
+  return source;
+}
+
+static void engine_benchmark(const char* name, LexerEngine engine, const char* source) {
+  size_t size        = strlen(source);
+  double best        = 1e30;
+  size_t token_count = 0;
+
+  for (size_t run = 0; run < RUN_COUNT; ++run) {
+    ReflectLexer lexer;
+    ReflectToken token;
+    reflect_lexer_init(&lexer, source);
+
+    token_count  = 0;
+    double start = time_now();
+    while (true) {
+      if (!engine(&lexer, &token)) {
+        continue;
+      }
+      if (token.type == REFLECT_TOKEN_EOF) {
+        break;
+      }
+      token_count++;
+    }
+    double elapsed = time_now() - start;
+    if (elapsed < best) {
+      best = elapsed;
+    }
+  }
+
+  printf(
+    "  %-8s %8.1f MB/s %8.2f ns/token (%zu tokens)\n",
+    name,
+    (double)size / best / 1e6,
+    best * 1e9 / (double)token_count,
+    token_count
+  );
+}
+
+static void mode_benchmark(const char* name, ReflectLexerMode mode, const char* source) {
+  size_t size        = strlen(source);
+  double best        = 1e30;
+  size_t token_count = 0;
+
+  for (size_t run = 0; run < RUN_COUNT; ++run) {
+    ReflectLexer lexer;
+    ReflectToken token;
+    reflect_lexer_init(&lexer, source);
+    reflect_lexer_mode_set(&lexer, mode);
+
+    token_count  = 0;
+    double start = time_now();
+    while (true) {
+      if (!reflect_lexer_token_next(&lexer, &token)) {
+        continue;
+      }
+      if (token.type == REFLECT_TOKEN_EOF) {
+        break;
+      }
+      token_count++;
+    }
+    double elapsed = time_now() - start;
+    if (elapsed < best) {
+      best = elapsed;
+    }
+  }
+
+  printf(
+    "  %-13s %8.1f MB/s %8.2f ms (%zu tokens)\n",
+    name,
+    (double)size / best / 1e6,
+    best * 1e3,
+    token_count
+  );
+}
+
+static void store_benchmark(const char* source) {
+  ReflectTokenBuffer buffer;
+  ReflectTokenStore  store;
+  if (!reflect_token_buffer_lex(&buffer, source)) {
+    fprintf(stderr, "could not lex the benchmark source\n");
+    return;
+  }
+
+  reflect_token_store_init(&store);
+  double start = time_now();
+  for (size_t i = 0; i < buffer.count; ++i) {
+    if (!reflect_token_store_push(&store, &buffer.tokens[i])) {
+      fprintf(stderr, "could not push token %zu\n", i);
+      goto cleanup;
+    }
+  }
+  double encode = time_now() - start;
+
+  double       decode   = 1e30;
+  ReflectToken token;
+  uint64_t     checksum = 0;
+  for (size_t run = 0; run < RUN_COUNT; ++run) {
+    ReflectTokenStoreCursor cursor;
+    start = time_now();
+    reflect_token_store_cursor_init(&cursor, &store, 0);
+    while (reflect_token_store_cursor_next(&cursor, &token)) {
+      checksum += token.type + token.location.column;
+    }
+    double elapsed = time_now() - start;
+    if (elapsed < decode) {
+      decode = elapsed;
+    }
+  }
+
+  double                 columns = 1e30;
+  ReflectTokenStoreEntry entries[256];
+  for (size_t run = 0; run < RUN_COUNT; ++run) {
+    ReflectTokenStoreCursor cursor;
+    size_t                  count;
+    start = time_now();
+    reflect_token_store_cursor_init(&cursor, &store, 0);
+    while ((count = reflect_token_store_cursor_entries_read(&cursor, entries, 256)) > 0) {
+      for (size_t i = 0; i < count; ++i) {
+        checksum += entries[i].type + entries[i].location.column + entries[i].string;
+      }
+    }
+    double elapsed = time_now() - start;
+    if (elapsed < columns) {
+      columns = elapsed;
+    }
+  }
+
+  // Pseudo random indices, so every lookup seeks from its block.
+  size_t lookup_count = 1000000;
+  size_t index        = 0;
+  start = time_now();
+  for (size_t i = 0; i < lookup_count; ++i) {
+    index = (index * 6364136223846793005ull + 1442695040888963407ull) % store.count;
+    reflect_token_store_get(&store, index, &token);
+    checksum += token.type;
+  }
+  double lookup = time_now() - start;
+
+  size_t raw_size    = buffer.count * sizeof(ReflectToken);
+  size_t stored_size = reflect_token_store_size_get(&store);
+  printf("Token Store (%zu tokens, checksum %llu):\n", store.count, (unsigned long long)checksum);
+  printf("  size     %8.2f MB stored, %8.2f MB as ReflectToken, ratio %.1fx\n", (double)stored_size / 1e6, (double)raw_size / 1e6, (double)raw_size / (double)stored_size);
+  printf("  size     %8.2f bytes/token, %.2f bytes/source byte\n", (double)stored_size / (double)store.count, (double)stored_size / (double)strlen(source));
+  printf("  encode   %8.2f ns/token\n", encode * 1e9 / (double)store.count);
+  printf("  decode   %8.2f ns/token, %.2f GB/s stored\n", decode * 1e9 / (double)store.count, (double)stored_size / decode / 1e9);
+  printf("  columns  %8.2f ns/token, %.2f GB/s stored\n", columns * 1e9 / (double)store.count, (double)stored_size / columns / 1e9);
+  printf("  get      %8.2f ns/token\n", lookup * 1e9 / (double)lookup_count);
+
+cleanup:
+  reflect_token_store_free(&store);
+  reflect_token_buffer_free(&buffer);
+}
+
+int main(void) {
+  char* source = source_generate(SOURCE_SIZE);
+  if (!source) {
+    fprintf(stderr, "could not allocate the benchmark source\n");
+    return 1;
+  }
+
+  printf("Lexer Engines (%zu bytes, best of %d):\n", strlen(source), RUN_COUNT);
+  engine_benchmark("switch", reflect_lexer_token_next_switch, source);
+  engine_benchmark("dfa", reflect_lexer_token_next_dfa, source);
+
+  printf("Lexer Modes:\n");
+  mode_benchmark("full", REFLECT_LEXER_MODE_FULL, source);
+  mode_benchmark("declarations", REFLECT_LEXER_MODE_DECLARATIONS, source);
+
+  store_benchmark(source);
+
+  free(source);
+  return 0;
+}
@@ -0,0 +1,166 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define REFLECT_IMPLEMENTATION
+#define REFLECT_POSIX
+#define REFLECT_IO_URING
+#include "../reflect.h"
+
+#define FILE_COUNT     512
+#define FILE_FUNCTIONS 400
+
+static char directory[] = "/tmp/reflect_pipeline_bench_XXXXXX";
+
+static double time_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+static size_t source_token_count(const char* source) {
+  ReflectLexer lexer;
+  ReflectToken token;
+  size_t       count = 0;
+  reflect_lexer_init(&lexer, source);
+  while (true) {
+    if (!reflect_lexer_token_next(&lexer, &token)) {
+      continue;
+    }
+    if (token.type == REFLECT_TOKEN_EOF) {
+      break;
+    }
+    count++;
+  }
+  return count;
+}
+
+static void pipeline_callback(void* user_data, const char* path, const char* source, size_t size, int error) {
+  (void)path;
+  (void)size;
+  (void)error;
+  if (source) {
+    __atomic_add_fetch((size_t*)user_data, source_token_count(source), __ATOMIC_RELAXED);
+  }
+}
+
+// Drops the files from the page cache, so the next run has to read them from disk.
+static void cache_drop(const char* const* paths) {
+  for (size_t file = 0; file < FILE_COUNT; ++file) {
+    int fd = open(paths[file], O_RDONLY);
+    if (fd >= 0) {
+      fdatasync(fd);
+      posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+      close(fd);
+    }
+  }
+}
+
+static char* file_read(const char* path) {
+  FILE* stream = fopen(path, "rb");
+  if (!stream) {
+    return NULL;
+  }
+
+  char* source = NULL;
+  long  size   = fseek(stream, 0, SEEK_END) == 0 ? ftell(stream) : -1;
+  if (size >= 0 && fseek(stream, 0, SEEK_SET) == 0 && (source = malloc((size_t)size + 1))) {
+    source[fread(source, 1, (size_t)size, stream)] = '\0';
+  }
+  fclose(stream);
+  return source;
+}
+
+static size_t sequential_run(const char* const* paths) {
+  size_t count = 0;
+  for (size_t file = 0; file < FILE_COUNT; ++file) {
+    char* source = file_read(paths[file]);
+    if (source) {
+      count += source_token_count(source);
+      free(source);
+    }
+  }
+  return count;
+}
+
+// Runs `backend` through the pipeline, or reads and lexes every file on the calling thread when `sequential` is set.
+static void pipeline_benchmark(const char* name, bool sequential, ReflectPipelineBackend backend, const char* const* paths, size_t total_size, bool cold) {
+  ReflectPipelineOptions options;
+  reflect_pipeline_options_default(&options);
+  options.backend = backend;
+
+  if (cold) {
+    cache_drop(paths);
+  }
+
+  size_t                 count = 0;
+  ReflectPipelineBackend used  = backend;
+  double                 start = time_now();
+  if (sequential) {
+    count = sequential_run(paths);
+  } else if (!reflect_pipeline_run(&options, paths, FILE_COUNT, pipeline_callback, &count, &used)) {
+    printf("  %-10s %-4s unavailable\n", name, cold ? "cold" : "warm");
+    return;
+  }
+  double elapsed = time_now() - start;
+
+  printf(
+    "  %-10s %-4s %8.1f MB/s %8.2f ms (%zu tokens)\n",
+    name,
+    cold ? "cold" : "warm",
+    (double)total_size / elapsed / 1e6,
+    elapsed * 1e3,
+    count
+  );
+}
+
+int main(void) {
+  if (!mkdtemp(directory)) {
+    perror("mkdtemp");
+    return 1;
+  }
+
+  static char names[FILE_COUNT][256];
+  const char* paths[FILE_COUNT];
+  size_t      total_size = 0;
+  for (size_t file = 0; file < FILE_COUNT; ++file) {
+    snprintf(names[file], sizeof(names[file]), "%s/file_%zu.c", directory, file);
+    paths[file] = names[file];
+
+    FILE* stream = fopen(names[file], "w");
+    if (!stream) {
+      fprintf(stderr, "could not generate the benchmark files\n");
+      return 1;
+    }
+    for (size_t i = 0; i < FILE_FUNCTIONS; ++i) {
+      fprintf(stream, "int function_%zu_%zu(struct Type* value) {\n  return value->field_%zu * %zu;\n}\n", file, i, i, file);
+    }
+    total_size += (size_t)ftell(stream);
+    fclose(stream);
+  }
+
+  ReflectPipelineOptions options;
+  reflect_pipeline_options_default(&options);
+  printf(
+    "Pipeline (%d files, %zu bytes, %u buffers, %u readers, %u workers):\n",
+    FILE_COUNT,
+    total_size,
+    options.buffer_count,
+    options.reader_count,
+    options.worker_count
+  );
+  for (int cold = 1; cold >= 0; --cold) {
+    pipeline_benchmark("sequential", true, REFLECT_PIPELINE_BACKEND_AUTO, paths, total_size, cold);
+    pipeline_benchmark("threads", false, REFLECT_PIPELINE_BACKEND_THREADS, paths, total_size, cold);
+    pipeline_benchmark("io_uring", false, REFLECT_PIPELINE_BACKEND_IO_URING, paths, total_size, cold);
+  }
+
+  for (size_t file = 0; file < FILE_COUNT; ++file) {
+    remove(names[file]);
+  }
+  remove(directory);
+  return 0;
+}
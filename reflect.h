@@ -1,6 +1,7 @@
 #ifndef reflect__H_
 #define reflect__H_
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -102,27 +103,274 @@ typedef enum ReflectError {
   REFLECT_ERROR_LEXER_BEGIN,
   REFLECT_ERROR_INVALID_CHARACTER       = REFLECT_ERROR_LEXER_BEGIN,
   REFLECT_ERROR_INVALID_INTEGER,
-  REFLECT_ERROR_LEXER_END               = REFLECT_ERROR_INVALID_INTEGER,
+  REFLECT_ERROR_UNTERMINATED_BODY,
+  REFLECT_ERROR_LEXER_END               = REFLECT_ERROR_UNTERMINATED_BODY,
   REFLECT_ERROR_COUNT,
 } ReflectError;
 
 #define REFLECT_LEXER_ERROR_STRING_MAX_LENGTH 512
 
+typedef enum ReflectLexerMode {
+  REFLECT_LEXER_MODE_FULL,
+  // Only file scope tokens, function bodies are skipped and produce an empty `{` `}` pair.
+  REFLECT_LEXER_MODE_DECLARATIONS,
+} ReflectLexerMode;
+
 typedef struct ReflectLexer {
   const char*           source;
   const char*           stream;
   ReflectError          error_code;
   char                  error_string[REFLECT_LEXER_ERROR_STRING_MAX_LENGTH];
   ReflectSourceLocation location;
+
+  ReflectLexerMode      mode;
+  const char*           end;
+  uint32_t              brace_depth;
+  ReflectTokenType      previous_type;
+  uint32_t              previous_line;
+  // File scope state of the current declaration, used to tell function bodies from type bodies.
+  uint32_t              paren_depth;
+  uint32_t              directive_line;
+  bool                  declaration_start;
+  bool                  declaration_type;
+  bool                  declaration_assign;
+  bool                  previous_attribute;
+  bool                  paren_call;
+  bool                  body_unterminated;
 } ReflectLexer;
 
 extern void         reflect_lexer_init(ReflectLexer* lexer, const char* source);
+extern void         reflect_lexer_mode_set(ReflectLexer* lexer, ReflectLexerMode mode);
 extern bool         reflect_lexer_token_next(ReflectLexer* lexer, ReflectToken* token);
 extern ReflectError reflect_lexer_error_code_get(ReflectLexer* lexer);
 extern const char*  reflect_lexer_error_string_get(ReflectLexer* lexer);
 
+// Both engines are always compiled, `reflect_lexer_token_next` uses the table driven one when
+// REFLECT_LEXER_DFA is defined. They produce the same token stream.
+extern bool         reflect_lexer_token_next_switch(ReflectLexer* lexer, ReflectToken* token);
+extern bool         reflect_lexer_token_next_dfa(ReflectLexer* lexer, ReflectToken* token);
+
 extern const char*  reflect_token_type_to_string(ReflectTokenType token_type);
 
+// A heap allocated array holding the whole token stream of a source, without the trailing EOF token.
+//
+// Invalid characters are skipped like `reflect_lexer_token_next` does, `error_code` keeps the first error.
+// `reflect_token_buffer_lex` only returns false when it runs out of memory.
+typedef struct ReflectTokenBuffer {
+  ReflectToken* tokens;
+  size_t        count;
+  size_t        capacity;
+  ReflectError  error_code;
+} ReflectTokenBuffer;
+
+extern bool         reflect_token_buffer_lex(ReflectTokenBuffer* buffer, const char* source);
+extern void         reflect_token_buffer_free(ReflectTokenBuffer* buffer);
+
+// A growable array of bytes.
+typedef struct ReflectBytes {
+  uint8_t* data;
+  size_t   size;
+  size_t   capacity;
+} ReflectBytes;
+
+// Deduplicated null terminated strings, addressed by a dense id in insertion order.
+typedef struct ReflectStringTable {
+  ReflectBytes strings;
+  uint32_t*    offsets;
+  uint32_t     count;
+  uint32_t     capacity;
+  uint32_t*    slots;
+  uint32_t     slot_count;
+} ReflectStringTable;
+
+extern void         reflect_string_table_init(ReflectStringTable* table);
+extern void         reflect_string_table_free(ReflectStringTable* table);
+extern bool         reflect_string_table_intern(ReflectStringTable* table, const char* string, uint32_t* id);
+extern bool         reflect_string_table_find(const ReflectStringTable* table, const char* string, uint32_t* id);
+extern const char*  reflect_string_table_get(const ReflectStringTable* table, uint32_t id);
+
+#define REFLECT_TOKEN_STORE_BLOCK_SIZE 64
+
+typedef struct ReflectTokenStoreBlock {
+  size_t                location_offset;
+  size_t                value_offset;
+  ReflectSourceLocation location;
+} ReflectTokenStoreBlock;
+
+// Compressed append-only token stream.
+//
+// Token types and modifiers are kept as one byte per token, locations as varint deltas from the
+// previous token, integer values and interned string ids in a separate varint column. Every
+// REFLECT_TOKEN_STORE_BLOCK_SIZE tokens a block records where the columns are, so reaching any
+// token only decodes the tokens before it in its block.
+//
+// Only integers keep `suffix_string`, it is empty in every other decoded token.
+typedef struct ReflectTokenStore {
+  ReflectBytes            types;
+  ReflectBytes            locations;
+  ReflectBytes            values;
+  ReflectStringTable      strings;
+  ReflectTokenStoreBlock* blocks;
+  size_t                  block_count;
+  size_t                  block_capacity;
+  size_t                  count;
+  ReflectSourceLocation   location;
+} ReflectTokenStore;
+
+typedef struct ReflectTokenStoreCursor {
+  const ReflectTokenStore* store;
+  size_t                   index;
+  size_t                   location_offset;
+  size_t                   value_offset;
+  ReflectSourceLocation    location;
+} ReflectTokenStoreCursor;
+
+extern void         reflect_token_store_init(ReflectTokenStore* store);
+extern void         reflect_token_store_free(ReflectTokenStore* store);
+extern bool         reflect_token_store_push(ReflectTokenStore* store, const ReflectToken* token);
+extern bool         reflect_token_store_get(const ReflectTokenStore* store, size_t index, ReflectToken* token);
+extern size_t       reflect_token_store_size_get(const ReflectTokenStore* store);
+
+// A token as the store keeps it, identifiers and integer suffixes are ids in the store's `strings`.
+typedef struct ReflectTokenStoreEntry {
+  ReflectTokenType      type;
+  ReflectModifier       modifier;
+  ReflectSourceLocation location;
+  uint64_t              integer;
+  uint32_t              string;
+} ReflectTokenStoreEntry;
+
+extern void         reflect_token_store_cursor_init(ReflectTokenStoreCursor* cursor, const ReflectTokenStore* store, size_t index);
+extern bool         reflect_token_store_cursor_next(ReflectTokenStoreCursor* cursor, ReflectToken* token);
+// Decodes up to `capacity` tokens column by column without copying strings into full ReflectTokens,
+// returns how many were decoded, zero at the end of the store.
+extern size_t       reflect_token_store_cursor_entries_read(ReflectTokenStoreCursor* cursor, ReflectTokenStoreEntry* entries, size_t capacity);
+
+#ifdef REFLECT_POSIX
+
+// Requires pthreads and POSIX.1-2008 (compile with -pthread -D_XOPEN_SOURCE=700).
+#include <pthread.h>
+#include <sys/types.h>
+
+#define REFLECT_TOKEN_CACHE_BUCKET_COUNT 1024
+
+typedef struct ReflectTokenCacheEntry ReflectTokenCacheEntry;
+
+// Process-wide cache of immutable token buffers, keyed by canonical path, modification time and size.
+//
+// Lookups walk the buckets without locking, only the first thread asking for a file lexes it while
+// the others wait for its result. Buffers are owned by the cache and stay valid until it is freed,
+// a file that changed on disk gets a new entry instead of invalidating the old one.
+typedef struct ReflectTokenCache {
+  ReflectTokenCacheEntry* buckets[REFLECT_TOKEN_CACHE_BUCKET_COUNT];
+  // Failed entries taken out of the buckets, freed with the cache.
+  ReflectTokenCacheEntry* retired;
+  pthread_mutex_t         mutex;
+  pthread_cond_t          condition;
+} ReflectTokenCache;
+
+extern bool                      reflect_token_cache_init(ReflectTokenCache* cache);
+extern void                      reflect_token_cache_free(ReflectTokenCache* cache);
+extern const ReflectTokenBuffer* reflect_token_cache_get(ReflectTokenCache* cache, const char* path);
+
+typedef struct ReflectIndexFile {
+  int64_t      mtime_seconds;
+  int64_t      mtime_nanoseconds;
+  int64_t      size;
+  bool         present;
+  // Varint (symbol, line, column) triples for every identifier in the file.
+  ReflectBytes occurrences;
+} ReflectIndexFile;
+
+// Identifier occurrence index over a set of files.
+//
+// Files are identified by the path they were added with. Updating a file only lexes it again
+// when its modification time or size changed, its occurrences replace the previous ones.
+typedef struct ReflectIndex {
+  ReflectStringTable symbols;
+  ReflectStringTable paths;
+  ReflectIndexFile*  files;
+  uint32_t           file_capacity;
+} ReflectIndex;
+
+extern void         reflect_index_init(ReflectIndex* index);
+extern void         reflect_index_free(ReflectIndex* index);
+extern bool         reflect_index_file_update(ReflectIndex* index, const char* path);
+extern void         reflect_index_file_remove(ReflectIndex* index, const char* path);
+extern bool         reflect_index_write(const ReflectIndex* index, const char* path);
+extern bool         reflect_index_read(ReflectIndex* index, const char* path);
+
+// Read only view of an index file written by `reflect_index_write`, mapped in memory.
+//
+// Symbols are found through an open addressing hash table stored in the file, their postings are
+// sorted by file and location and delta encoded as varints.
+typedef struct ReflectIndexView {
+  const uint8_t* data;
+  size_t         size;
+} ReflectIndexView;
+
+typedef struct ReflectIndexPosting {
+  uint32_t              file;
+  ReflectSourceLocation location;
+} ReflectIndexPosting;
+
+typedef struct ReflectIndexIterator {
+  const uint8_t*      data;
+  size_t              size;
+  size_t              offset;
+  uint32_t            file_count;
+  uint32_t            remaining;
+  ReflectIndexPosting posting;
+} ReflectIndexIterator;
+
+extern bool         reflect_index_view_open(ReflectIndexView* view, const char* path);
+extern void         reflect_index_view_close(ReflectIndexView* view);
+extern uint32_t     reflect_index_view_file_count_get(const ReflectIndexView* view);
+extern const char*  reflect_index_view_file_path_get(const ReflectIndexView* view, uint32_t file);
+extern uint32_t     reflect_index_view_find(const ReflectIndexView* view, const char* symbol, ReflectIndexIterator* iterator);
+extern bool         reflect_index_iterator_next(ReflectIndexIterator* iterator, ReflectIndexPosting* posting);
+
+typedef enum ReflectPipelineBackend {
+  REFLECT_PIPELINE_BACKEND_AUTO,
+  REFLECT_PIPELINE_BACKEND_THREADS,
+  // Only available on Linux when REFLECT_IO_URING is defined (also needs _DEFAULT_SOURCE for syscall).
+  REFLECT_PIPELINE_BACKEND_IO_URING,
+} ReflectPipelineBackend;
+
+typedef struct ReflectPipelineOptions {
+  ReflectPipelineBackend backend;
+  uint32_t               buffer_count;
+  size_t                 buffer_size;
+  // Largest a buffer may grow to hold a file, larger files fail with EFBIG. Zero means no limit.
+  size_t                 buffer_size_max;
+  uint32_t               reader_count;
+  uint32_t               worker_count;
+} ReflectPipelineOptions;
+
+// Called on a worker thread for every file, `source` is null terminated and only valid during the
+// call. It is NULL when the file could not be read, `error` then holds the errno value.
+typedef void (*ReflectPipelineCallback)(void* user_data, const char* path, const char* source, size_t size, int error);
+
+extern void         reflect_pipeline_options_default(ReflectPipelineOptions* options);
+
+// Reads `paths` into a pool of `buffer_count` page aligned buffers while `worker_count` threads
+// hand the filled ones to `callback`, so reading a file overlaps with processing the ones before it.
+//
+// Buffers start at `buffer_size`, grow to the largest file they held and are reused. Memory stays
+// below `buffer_count` times the larger of `buffer_size` and `buffer_size_max`.
+// Reads go through io_uring when available, otherwise through `reader_count` threads. Asking for
+// REFLECT_PIPELINE_BACKEND_IO_URING where it is not available fails with errno set to ENOSYS.
+extern bool         reflect_pipeline_run(
+                      const ReflectPipelineOptions* options,
+                      const char* const*            paths,
+                      size_t                        path_count,
+                      ReflectPipelineCallback       callback,
+                      void*                         user_data,
+                      ReflectPipelineBackend*       backend
+                    );
+
+#endif // REFLECT_POSIX
+
 
 // #-----------------------------------------------------------------------------------------#
 // |                                  IMPLEMENTATION                                         |
@@ -132,6 +380,7 @@ extern const char*  reflect_token_type_to_string(ReflectTokenType token_type);
 
 #include <ctype.h>
 #include <string.h>
+#include <stdlib.h>
 #include <assert.h>
 
 #define REFLECT_API
@@ -201,6 +450,24 @@ REFLECT_API void reflect_lexer_init(ReflectLexer* lexer, const char* source) {
   
   lexer->error_code      = REFLECT_ERROR_NONE;
   strcpy(lexer->error_string, "");
+
+  lexer->mode               = REFLECT_LEXER_MODE_FULL;
+  lexer->end                = NULL;
+  lexer->brace_depth        = 0;
+  lexer->previous_type      = REFLECT_TOKEN_EOF;
+  lexer->previous_line      = 0;
+  lexer->paren_depth        = 0;
+  lexer->directive_line     = 0;
+  lexer->declaration_start  = true;
+  lexer->declaration_type   = false;
+  lexer->declaration_assign = false;
+  lexer->previous_attribute = false;
+  lexer->paren_call         = false;
+  lexer->body_unterminated  = false;
+}
+
+REFLECT_API void reflect_lexer_mode_set(ReflectLexer* lexer, ReflectLexerMode mode) {
+  lexer->mode = mode;
 }
 
 REFLECT_API ReflectError reflect_lexer_error_code_get(ReflectLexer* lexer) {
@@ -351,7 +618,19 @@ static bool reflect__lexer_token_integer_lex(ReflectLexer* lexer, ReflectToken*
   return true;
 }
 
-REFLECT_API bool reflect_lexer_token_next(ReflectLexer* lexer, ReflectToken* token) {
+static void reflect__lexer_invalid_character(ReflectLexer* lexer) {
+  lexer->error_code = REFLECT_ERROR_INVALID_CHARACTER;
+  snprintf(
+    lexer->error_string,
+    REFLECT_LEXER_ERROR_STRING_MAX_LENGTH,
+    "invalid character '%c'",
+    reflect__lexer_char_current(lexer)
+  );
+  // Skip over invalid character
+  reflect__lexer_char_advance(lexer);
+}
+
+REFLECT_API bool reflect_lexer_token_next_switch(ReflectLexer* lexer, ReflectToken* token) {
 
 #define REFLECT__LEXER_CASE1(c, t)      \
   case (c):                             \
@@ -491,15 +770,7 @@ reflect__lexer_again:
       token->location = lexer->location;
       return true;
     default:
-      lexer->error_code = REFLECT_ERROR_INVALID_CHARACTER;
-      snprintf(
-        lexer->error_string,
-        REFLECT_LEXER_ERROR_STRING_MAX_LENGTH,
-        "invalid character '%c'",
-        reflect__lexer_char_current(lexer)
-      );
-      // Skip over invalid character
-      reflect__lexer_char_advance(lexer);
+      reflect__lexer_invalid_character(lexer);
       return false;
   }
 
@@ -508,6 +779,2350 @@ reflect__lexer_again:
   #undef REFLECT__LEXER_CASE3
 }
 
+// Table driven engine, selected with REFLECT_LEXER_DFA.
+//
+// The first byte of a token is mapped to a class which picks the handler, punctuators are then
+// matched by walking `reflect__lexer_dfa_next` and keeping the longest accepted prefix. With GCC
+// and Clang the handlers are reached through computed gotos, everywhere else through a switch.
+
+#if defined(__GNUC__) && !defined(REFLECT_LEXER_NO_COMPUTED_GOTO)
+#define REFLECT__LEXER_COMPUTED_GOTO
+#endif
+
+typedef enum ReflectLexerDfaClass {
+  REFLECT__LEXER_DFA_CLASS_INVALID,
+  REFLECT__LEXER_DFA_CLASS_EOF,
+  REFLECT__LEXER_DFA_CLASS_NEWLINE,
+  REFLECT__LEXER_DFA_CLASS_SPACE,
+  REFLECT__LEXER_DFA_CLASS_IDENTIFIER,
+  REFLECT__LEXER_DFA_CLASS_DIGIT,
+  REFLECT__LEXER_DFA_CLASS_PUNCTUATOR,
+  REFLECT__LEXER_DFA_CLASS_COUNT,
+} ReflectLexerDfaClass;
+
+#define REFLECT__LEXER_DFA_LOWER(c) \
+  [(c)] = REFLECT__LEXER_DFA_CLASS_IDENTIFIER, [(c) - 'a' + 'A'] = REFLECT__LEXER_DFA_CLASS_IDENTIFIER
+
+static const uint8_t reflect__lexer_dfa_class[256] = {
+  ['\0'] = REFLECT__LEXER_DFA_CLASS_EOF,
+  ['\n'] = REFLECT__LEXER_DFA_CLASS_NEWLINE,
+  [' ']  = REFLECT__LEXER_DFA_CLASS_SPACE,
+  ['_']  = REFLECT__LEXER_DFA_CLASS_IDENTIFIER,
+
+  REFLECT__LEXER_DFA_LOWER('a'), REFLECT__LEXER_DFA_LOWER('b'), REFLECT__LEXER_DFA_LOWER('c'),
+  REFLECT__LEXER_DFA_LOWER('d'), REFLECT__LEXER_DFA_LOWER('e'), REFLECT__LEXER_DFA_LOWER('f'),
+  REFLECT__LEXER_DFA_LOWER('g'), REFLECT__LEXER_DFA_LOWER('h'), REFLECT__LEXER_DFA_LOWER('i'),
+  REFLECT__LEXER_DFA_LOWER('j'), REFLECT__LEXER_DFA_LOWER('k'), REFLECT__LEXER_DFA_LOWER('l'),
+  REFLECT__LEXER_DFA_LOWER('m'), REFLECT__LEXER_DFA_LOWER('n'), REFLECT__LEXER_DFA_LOWER('o'),
+  REFLECT__LEXER_DFA_LOWER('p'), REFLECT__LEXER_DFA_LOWER('q'), REFLECT__LEXER_DFA_LOWER('r'),
+  REFLECT__LEXER_DFA_LOWER('s'), REFLECT__LEXER_DFA_LOWER('t'), REFLECT__LEXER_DFA_LOWER('u'),
+  REFLECT__LEXER_DFA_LOWER('v'), REFLECT__LEXER_DFA_LOWER('w'), REFLECT__LEXER_DFA_LOWER('x'),
+  REFLECT__LEXER_DFA_LOWER('y'), REFLECT__LEXER_DFA_LOWER('z'),
+
+  ['0'] = REFLECT__LEXER_DFA_CLASS_DIGIT, ['1'] = REFLECT__LEXER_DFA_CLASS_DIGIT,
+  ['2'] = REFLECT__LEXER_DFA_CLASS_DIGIT, ['3'] = REFLECT__LEXER_DFA_CLASS_DIGIT,
+  ['4'] = REFLECT__LEXER_DFA_CLASS_DIGIT, ['5'] = REFLECT__LEXER_DFA_CLASS_DIGIT,
+  ['6'] = REFLECT__LEXER_DFA_CLASS_DIGIT, ['7'] = REFLECT__LEXER_DFA_CLASS_DIGIT,
+  ['8'] = REFLECT__LEXER_DFA_CLASS_DIGIT, ['9'] = REFLECT__LEXER_DFA_CLASS_DIGIT,
+
+  ['['] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR, [']'] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR,
+  ['('] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR, [')'] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR,
+  ['{'] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR, ['}'] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR,
+  [','] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR, ['~'] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR,
+  ['?'] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR, [':'] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR,
+  [';'] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR, ['#'] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR,
+  ['^'] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR, ['='] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR,
+  ['%'] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR, ['!'] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR,
+  ['*'] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR, ['&'] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR,
+  ['|'] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR, ['+'] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR,
+  ['.'] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR, ['-'] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR,
+  ['/'] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR, ['<'] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR,
+  ['>'] = REFLECT__LEXER_DFA_CLASS_PUNCTUATOR,
+};
+
+#undef REFLECT__LEXER_DFA_LOWER
+
+// One state per punctuator prefix, every state except DOT_DOT accepts.
+typedef enum ReflectLexerDfaState {
+  REFLECT__LEXER_DFA_DEAD,
+  REFLECT__LEXER_DFA_START,
+  REFLECT__LEXER_DFA_LBRACKET,
+  REFLECT__LEXER_DFA_RBRACKET,
+  REFLECT__LEXER_DFA_LPAREN,
+  REFLECT__LEXER_DFA_RPAREN,
+  REFLECT__LEXER_DFA_LBRACE,
+  REFLECT__LEXER_DFA_RBRACE,
+  REFLECT__LEXER_DFA_COMMA,
+  REFLECT__LEXER_DFA_TILDE,
+  REFLECT__LEXER_DFA_QUESTION,
+  REFLECT__LEXER_DFA_COLON,
+  REFLECT__LEXER_DFA_SEMICOLON,
+  REFLECT__LEXER_DFA_HASH,
+  REFLECT__LEXER_DFA_HASH_HASH,
+  REFLECT__LEXER_DFA_CARET,
+  REFLECT__LEXER_DFA_XOR_ASSIGN,
+  REFLECT__LEXER_DFA_ASSIGN,
+  REFLECT__LEXER_DFA_EQUALS,
+  REFLECT__LEXER_DFA_PERCENT,
+  REFLECT__LEXER_DFA_MOD_ASSIGN,
+  REFLECT__LEXER_DFA_NOT,
+  REFLECT__LEXER_DFA_NOT_EQUALS,
+  REFLECT__LEXER_DFA_STAR,
+  REFLECT__LEXER_DFA_MUL_ASSIGN,
+  REFLECT__LEXER_DFA_AMPERSAND,
+  REFLECT__LEXER_DFA_AND_ASSIGN,
+  REFLECT__LEXER_DFA_LOGICAL_AND,
+  REFLECT__LEXER_DFA_PIPE,
+  REFLECT__LEXER_DFA_OR_ASSIGN,
+  REFLECT__LEXER_DFA_LOGICAL_OR,
+  REFLECT__LEXER_DFA_PLUS,
+  REFLECT__LEXER_DFA_ADD_ASSIGN,
+  REFLECT__LEXER_DFA_INCREMENT,
+  REFLECT__LEXER_DFA_DOT,
+  REFLECT__LEXER_DFA_DOT_DOT,
+  REFLECT__LEXER_DFA_ELLIPSIS,
+  REFLECT__LEXER_DFA_MINUS,
+  REFLECT__LEXER_DFA_DECREMENT,
+  REFLECT__LEXER_DFA_SUB_ASSIGN,
+  REFLECT__LEXER_DFA_ARROW,
+  REFLECT__LEXER_DFA_SLASH,
+  REFLECT__LEXER_DFA_DIV_ASSIGN,
+  REFLECT__LEXER_DFA_LESS,
+  REFLECT__LEXER_DFA_LESS_EQUAL,
+  REFLECT__LEXER_DFA_LSHIFT,
+  REFLECT__LEXER_DFA_LSHIFT_ASSIGN,
+  REFLECT__LEXER_DFA_GREATER,
+  REFLECT__LEXER_DFA_GREATER_EQUAL,
+  REFLECT__LEXER_DFA_RSHIFT,
+  REFLECT__LEXER_DFA_RSHIFT_ASSIGN,
+  REFLECT__LEXER_DFA_STATE_COUNT,
+} ReflectLexerDfaState;
+
+#define REFLECT__LEXER_DFA_EDGE(from, c, to) [REFLECT__LEXER_DFA_##from][(c)] = REFLECT__LEXER_DFA_##to
+
+static const uint8_t reflect__lexer_dfa_next[REFLECT__LEXER_DFA_STATE_COUNT][256] = {
+  REFLECT__LEXER_DFA_EDGE(START,     '[', LBRACKET),
+  REFLECT__LEXER_DFA_EDGE(START,     ']', RBRACKET),
+  REFLECT__LEXER_DFA_EDGE(START,     '(', LPAREN),
+  REFLECT__LEXER_DFA_EDGE(START,     ')', RPAREN),
+  REFLECT__LEXER_DFA_EDGE(START,     '{', LBRACE),
+  REFLECT__LEXER_DFA_EDGE(START,     '}', RBRACE),
+  REFLECT__LEXER_DFA_EDGE(START,     ',', COMMA),
+  REFLECT__LEXER_DFA_EDGE(START,     '~', TILDE),
+  REFLECT__LEXER_DFA_EDGE(START,     '?', QUESTION),
+  REFLECT__LEXER_DFA_EDGE(START,     ':', COLON),
+  REFLECT__LEXER_DFA_EDGE(START,     ';', SEMICOLON),
+  REFLECT__LEXER_DFA_EDGE(START,     '#', HASH),
+  REFLECT__LEXER_DFA_EDGE(HASH,      '#', HASH_HASH),
+  REFLECT__LEXER_DFA_EDGE(START,     '^', CARET),
+  REFLECT__LEXER_DFA_EDGE(CARET,     '=', XOR_ASSIGN),
+  REFLECT__LEXER_DFA_EDGE(START,     '=', ASSIGN),
+  REFLECT__LEXER_DFA_EDGE(ASSIGN,    '=', EQUALS),
+  REFLECT__LEXER_DFA_EDGE(START,     '%', PERCENT),
+  REFLECT__LEXER_DFA_EDGE(PERCENT,   '=', MOD_ASSIGN),
+  REFLECT__LEXER_DFA_EDGE(START,     '!', NOT),
+  REFLECT__LEXER_DFA_EDGE(NOT,       '=', NOT_EQUALS),
+  REFLECT__LEXER_DFA_EDGE(START,     '*', STAR),
+  REFLECT__LEXER_DFA_EDGE(STAR,      '=', MUL_ASSIGN),
+  REFLECT__LEXER_DFA_EDGE(START,     '&', AMPERSAND),
+  REFLECT__LEXER_DFA_EDGE(AMPERSAND, '=', AND_ASSIGN),
+  REFLECT__LEXER_DFA_EDGE(AMPERSAND, '&', LOGICAL_AND),
+  REFLECT__LEXER_DFA_EDGE(START,     '|', PIPE),
+  REFLECT__LEXER_DFA_EDGE(PIPE,      '=', OR_ASSIGN),
+  REFLECT__LEXER_DFA_EDGE(PIPE,      '|', LOGICAL_OR),
+  REFLECT__LEXER_DFA_EDGE(START,     '+', PLUS),
+  REFLECT__LEXER_DFA_EDGE(PLUS,      '=', ADD_ASSIGN),
+  REFLECT__LEXER_DFA_EDGE(PLUS,      '+', INCREMENT),
+  REFLECT__LEXER_DFA_EDGE(START,     '.', DOT),
+  REFLECT__LEXER_DFA_EDGE(DOT,       '.', DOT_DOT),
+  REFLECT__LEXER_DFA_EDGE(DOT_DOT,   '.', ELLIPSIS),
+  REFLECT__LEXER_DFA_EDGE(START,     '-', MINUS),
+  REFLECT__LEXER_DFA_EDGE(MINUS,     '-', DECREMENT),
+  REFLECT__LEXER_DFA_EDGE(MINUS,     '=', SUB_ASSIGN),
+  REFLECT__LEXER_DFA_EDGE(MINUS,     '>', ARROW),
+  REFLECT__LEXER_DFA_EDGE(START,     '/', SLASH),
+  REFLECT__LEXER_DFA_EDGE(SLASH,     '=', DIV_ASSIGN),
+  REFLECT__LEXER_DFA_EDGE(START,     '<', LESS),
+  REFLECT__LEXER_DFA_EDGE(LESS,      '=', LESS_EQUAL),
+  REFLECT__LEXER_DFA_EDGE(LESS,      '<', LSHIFT),
+  REFLECT__LEXER_DFA_EDGE(LSHIFT,    '=', LSHIFT_ASSIGN),
+  REFLECT__LEXER_DFA_EDGE(START,     '>', GREATER),
+  REFLECT__LEXER_DFA_EDGE(GREATER,   '=', GREATER_EQUAL),
+  REFLECT__LEXER_DFA_EDGE(GREATER,   '>', RSHIFT),
+  REFLECT__LEXER_DFA_EDGE(RSHIFT,    '=', RSHIFT_ASSIGN),
+};
+
+#undef REFLECT__LEXER_DFA_EDGE
+
+#define REFLECT__LEXER_DFA_ACCEPT(state) [REFLECT__LEXER_DFA_##state] = REFLECT_TOKEN_##state
+
+static const uint8_t reflect__lexer_dfa_accept[REFLECT__LEXER_DFA_STATE_COUNT] = {
+  [REFLECT__LEXER_DFA_DEAD]    = REFLECT_TOKEN_COUNT,
+  [REFLECT__LEXER_DFA_START]   = REFLECT_TOKEN_COUNT,
+  [REFLECT__LEXER_DFA_DOT_DOT] = REFLECT_TOKEN_COUNT,
+  REFLECT__LEXER_DFA_ACCEPT(LBRACKET),   REFLECT__LEXER_DFA_ACCEPT(RBRACKET),
+  REFLECT__LEXER_DFA_ACCEPT(LPAREN),     REFLECT__LEXER_DFA_ACCEPT(RPAREN),
+  REFLECT__LEXER_DFA_ACCEPT(LBRACE),     REFLECT__LEXER_DFA_ACCEPT(RBRACE),
+  REFLECT__LEXER_DFA_ACCEPT(COMMA),      REFLECT__LEXER_DFA_ACCEPT(TILDE),
+  REFLECT__LEXER_DFA_ACCEPT(QUESTION),   REFLECT__LEXER_DFA_ACCEPT(COLON),
+  REFLECT__LEXER_DFA_ACCEPT(SEMICOLON),  REFLECT__LEXER_DFA_ACCEPT(HASH),
+  REFLECT__LEXER_DFA_ACCEPT(HASH_HASH),  REFLECT__LEXER_DFA_ACCEPT(CARET),
+  REFLECT__LEXER_DFA_ACCEPT(XOR_ASSIGN), REFLECT__LEXER_DFA_ACCEPT(ASSIGN),
+  REFLECT__LEXER_DFA_ACCEPT(EQUALS),     REFLECT__LEXER_DFA_ACCEPT(PERCENT),
+  REFLECT__LEXER_DFA_ACCEPT(MOD_ASSIGN), REFLECT__LEXER_DFA_ACCEPT(NOT),
+  REFLECT__LEXER_DFA_ACCEPT(NOT_EQUALS), REFLECT__LEXER_DFA_ACCEPT(STAR),
+  REFLECT__LEXER_DFA_ACCEPT(MUL_ASSIGN), REFLECT__LEXER_DFA_ACCEPT(AMPERSAND),
+  REFLECT__LEXER_DFA_ACCEPT(AND_ASSIGN), REFLECT__LEXER_DFA_ACCEPT(LOGICAL_AND),
+  REFLECT__LEXER_DFA_ACCEPT(PIPE),       REFLECT__LEXER_DFA_ACCEPT(OR_ASSIGN),
+  REFLECT__LEXER_DFA_ACCEPT(LOGICAL_OR), REFLECT__LEXER_DFA_ACCEPT(PLUS),
+  REFLECT__LEXER_DFA_ACCEPT(ADD_ASSIGN), REFLECT__LEXER_DFA_ACCEPT(INCREMENT),
+  REFLECT__LEXER_DFA_ACCEPT(DOT),        REFLECT__LEXER_DFA_ACCEPT(ELLIPSIS),
+  REFLECT__LEXER_DFA_ACCEPT(MINUS),      REFLECT__LEXER_DFA_ACCEPT(DECREMENT),
+  REFLECT__LEXER_DFA_ACCEPT(SUB_ASSIGN), REFLECT__LEXER_DFA_ACCEPT(ARROW),
+  REFLECT__LEXER_DFA_ACCEPT(SLASH),      REFLECT__LEXER_DFA_ACCEPT(DIV_ASSIGN),
+  REFLECT__LEXER_DFA_ACCEPT(LESS),       REFLECT__LEXER_DFA_ACCEPT(LESS_EQUAL),
+  REFLECT__LEXER_DFA_ACCEPT(LSHIFT),     REFLECT__LEXER_DFA_ACCEPT(LSHIFT_ASSIGN),
+  REFLECT__LEXER_DFA_ACCEPT(GREATER),    REFLECT__LEXER_DFA_ACCEPT(GREATER_EQUAL),
+  REFLECT__LEXER_DFA_ACCEPT(RSHIFT),     REFLECT__LEXER_DFA_ACCEPT(RSHIFT_ASSIGN),
+};
+
+#undef REFLECT__LEXER_DFA_ACCEPT
+
+// The switch engine reports tokens starting with '-', '/', '<' and '>' at their end location, these
+// states mirror that so both engines produce the same stream.
+#define REFLECT__LEXER_DFA_AT_END(state) [REFLECT__LEXER_DFA_##state] = true
+
+static const bool reflect__lexer_dfa_location_at_end[REFLECT__LEXER_DFA_STATE_COUNT] = {
+  REFLECT__LEXER_DFA_AT_END(MINUS),      REFLECT__LEXER_DFA_AT_END(DECREMENT),
+  REFLECT__LEXER_DFA_AT_END(SUB_ASSIGN), REFLECT__LEXER_DFA_AT_END(ARROW),
+  REFLECT__LEXER_DFA_AT_END(SLASH),      REFLECT__LEXER_DFA_AT_END(DIV_ASSIGN),
+  REFLECT__LEXER_DFA_AT_END(LESS),       REFLECT__LEXER_DFA_AT_END(LESS_EQUAL),
+  REFLECT__LEXER_DFA_AT_END(LSHIFT),     REFLECT__LEXER_DFA_AT_END(LSHIFT_ASSIGN),
+  REFLECT__LEXER_DFA_AT_END(GREATER),    REFLECT__LEXER_DFA_AT_END(GREATER_EQUAL),
+  REFLECT__LEXER_DFA_AT_END(RSHIFT),     REFLECT__LEXER_DFA_AT_END(RSHIFT_ASSIGN),
+};
+
+#undef REFLECT__LEXER_DFA_AT_END
+
+#ifdef REFLECT__LEXER_COMPUTED_GOTO
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#define REFLECT__LEXER_DFA_DISPATCH()                                                  \
+  token->location = lexer->location;                                                   \
+  token->modifier = REFLECT_MODIFIER_NONE;                                             \
+  goto *dispatch[reflect__lexer_dfa_class[(uint8_t)reflect__lexer_char_current(lexer)]]
+#else
+#define REFLECT__LEXER_DFA_DISPATCH()                                                  \
+  token->location = lexer->location;                                                   \
+  token->modifier = REFLECT_MODIFIER_NONE;                                             \
+  switch (reflect__lexer_dfa_class[(uint8_t)reflect__lexer_char_current(lexer)]) {     \
+    case REFLECT__LEXER_DFA_CLASS_EOF:        goto reflect__lexer_dfa_eof;             \
+    case REFLECT__LEXER_DFA_CLASS_NEWLINE:    goto reflect__lexer_dfa_newline;         \
+    case REFLECT__LEXER_DFA_CLASS_SPACE:      goto reflect__lexer_dfa_space;           \
+    case REFLECT__LEXER_DFA_CLASS_IDENTIFIER: goto reflect__lexer_dfa_identifier;      \
+    case REFLECT__LEXER_DFA_CLASS_DIGIT:      goto reflect__lexer_dfa_digit;           \
+    case REFLECT__LEXER_DFA_CLASS_PUNCTUATOR: goto reflect__lexer_dfa_punctuator;      \
+    default:                                  goto reflect__lexer_dfa_invalid;         \
+  }
+#endif
+
+REFLECT_API bool reflect_lexer_token_next_dfa(ReflectLexer* lexer, ReflectToken* token) {
+#ifdef REFLECT__LEXER_COMPUTED_GOTO
+  static const void* const dispatch[REFLECT__LEXER_DFA_CLASS_COUNT] = {
+    [REFLECT__LEXER_DFA_CLASS_INVALID]    = &&reflect__lexer_dfa_invalid,
+    [REFLECT__LEXER_DFA_CLASS_EOF]        = &&reflect__lexer_dfa_eof,
+    [REFLECT__LEXER_DFA_CLASS_NEWLINE]    = &&reflect__lexer_dfa_newline,
+    [REFLECT__LEXER_DFA_CLASS_SPACE]      = &&reflect__lexer_dfa_space,
+    [REFLECT__LEXER_DFA_CLASS_IDENTIFIER] = &&reflect__lexer_dfa_identifier,
+    [REFLECT__LEXER_DFA_CLASS_DIGIT]      = &&reflect__lexer_dfa_digit,
+    [REFLECT__LEXER_DFA_CLASS_PUNCTUATOR] = &&reflect__lexer_dfa_punctuator,
+  };
+#endif
+
+  const char* stream;
+  uint8_t     state;
+  uint8_t     accepted_state;
+  uint32_t    length;
+  uint32_t    accepted_length;
+
+  REFLECT__LEXER_DFA_DISPATCH();
+
+reflect__lexer_dfa_newline:
+  lexer->location.line   += 1;
+  lexer->location.column  = 0;
+
+  // fallthrough
+reflect__lexer_dfa_space:
+  do {
+    reflect__lexer_char_advance(lexer);
+  } while (reflect__lexer_char_current(lexer) == ' ');
+  REFLECT__LEXER_DFA_DISPATCH();
+
+reflect__lexer_dfa_eof:
+  token->type = REFLECT_TOKEN_EOF;
+  return true;
+
+reflect__lexer_dfa_identifier:
+  return reflect__lexer_token_identifier_lex(lexer, token);
+
+reflect__lexer_dfa_digit:
+  return reflect__lexer_token_integer_lex(lexer, token);
+
+reflect__lexer_dfa_punctuator:
+  stream          = lexer->stream;
+  state           = reflect__lexer_dfa_next[REFLECT__LEXER_DFA_START][(uint8_t)stream[0]];
+  accepted_state  = REFLECT__LEXER_DFA_DEAD;
+  length          = 0;
+  accepted_length = 0;
+  while (state != REFLECT__LEXER_DFA_DEAD) {
+    ++length;
+    if (reflect__lexer_dfa_accept[state] != REFLECT_TOKEN_COUNT) {
+      accepted_state  = state;
+      accepted_length = length;
+    }
+    state = reflect__lexer_dfa_next[state][(uint8_t)stream[length]];
+  }
+
+  token->type              = (ReflectTokenType)reflect__lexer_dfa_accept[accepted_state];
+  lexer->stream           += accepted_length;
+  lexer->location.column  += accepted_length;
+  if (reflect__lexer_dfa_location_at_end[accepted_state]) {
+    token->location = lexer->location;
+  }
+  return true;
+
+reflect__lexer_dfa_invalid:
+  reflect__lexer_invalid_character(lexer);
+  return false;
+}
+
+#undef REFLECT__LEXER_DFA_DISPATCH
+
+#ifdef REFLECT__LEXER_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
+
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+#endif
+
+static bool reflect__lexer_body_char_is_special(const char c) {
+  return c == '{' || c == '}' || c == '"' || c == '\'' || c == '/';
+}
+
+// Returns the first brace, quote or slash in [stream, end), or `end`, counting the newlines before it.
+static const char* reflect__lexer_body_scan(const char* stream, const char* end, uint32_t* line, const char** line_start) {
+#if defined(__SSE2__) && defined(__GNUC__)
+  const __m128i lbrace  = _mm_set1_epi8('{');
+  const __m128i rbrace  = _mm_set1_epi8('}');
+  const __m128i dquote  = _mm_set1_epi8('"');
+  const __m128i squote  = _mm_set1_epi8('\'');
+  const __m128i slash   = _mm_set1_epi8('/');
+  const __m128i newline = _mm_set1_epi8('\n');
+  while (end - stream >= 16) {
+    __m128i  chunk    = _mm_loadu_si128((const __m128i*)(const void*)stream);
+    __m128i  matches  = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(chunk, lbrace), _mm_cmpeq_epi8(chunk, rbrace)),
+      _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, dquote), _mm_cmpeq_epi8(chunk, squote)), _mm_cmpeq_epi8(chunk, slash))
+    );
+    uint32_t special  = (uint32_t)_mm_movemask_epi8(matches);
+    uint32_t newlines = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+    if (special) {
+      newlines &= (1u << __builtin_ctz(special)) - 1;
+    }
+    if (newlines) {
+      *line       += (uint32_t)__builtin_popcount(newlines);
+      *line_start  = stream + (32 - __builtin_clz(newlines));
+    }
+    if (special) {
+      return stream + __builtin_ctz(special);
+    }
+    stream += 16;
+  }
+#endif
+
+  for (; stream < end; ++stream) {
+    if (reflect__lexer_body_char_is_special(*stream)) {
+      return stream;
+    }
+    if (*stream == '\n') {
+      *line       += 1;
+      *line_start  = stream + 1;
+    }
+  }
+  return end;
+}
+
+static void reflect__lexer_newlines_count(const char* stream, const char* end, uint32_t* line, const char** line_start) {
+  while ((stream = memchr(stream, '\n', (size_t)(end - stream)))) {
+    *line       += 1;
+    *line_start  = ++stream;
+  }
+}
+
+// Moves the stream from just after the `{` of a function body to its matching `}`, or to the end
+// of the source when it is never closed.
+static void reflect__lexer_body_skip(ReflectLexer* lexer) {
+  if (!lexer->end) {
+    lexer->end = lexer->stream + strlen(lexer->stream);
+  }
+
+  const char* stream     = lexer->stream;
+  const char* end        = lexer->end;
+  const char* line_start = NULL;
+  const char* next;
+  uint32_t    line       = lexer->location.line;
+  uint32_t    depth      = 1;
+  while ((stream = reflect__lexer_body_scan(stream, end, &line, &line_start)) < end) {
+    switch (*stream) {
+      case '{':
+        ++depth;
+        ++stream;
+        break;
+      case '}':
+        --depth;
+        if (depth == 0) {
+          goto reflect__lexer_body_end;
+        }
+        ++stream;
+        break;
+      case '"':
+      case '\'':
+        next = stream + 1;
+        while (next < end && *next != *stream && *next != '\n') {
+          next += *next == '\\' && next + 1 < end ? 2 : 1;
+        }
+        // An unterminated literal stops at the newline, which is left for the scanner to count.
+        reflect__lexer_newlines_count(stream, next, &line, &line_start);
+        stream = next < end && *next != '\n' ? next + 1 : next;
+        break;
+      case '/':
+        if (stream[1] == '/') {
+          next   = memchr(stream, '\n', (size_t)(end - stream));
+          stream = next ? next : end;
+        } else if (stream[1] == '*') {
+          next = stream + 2;
+          while ((next = memchr(next, '*', (size_t)(end - next))) && next[1] != '/') {
+            ++next;
+          }
+          next = next ? next + 2 : end;
+          reflect__lexer_newlines_count(stream, next, &line, &line_start);
+          stream = next;
+        } else {
+          ++stream;
+        }
+        break;
+      default:
+        assert(false && "Unreachable");
+    }
+  }
+
+reflect__lexer_body_end:
+  if (line_start) {
+    lexer->location.line   = line;
+    lexer->location.column = (uint32_t)(stream - line_start) + 1;
+  } else {
+    lexer->location.column += (uint32_t)(stream - lexer->stream);
+  }
+  lexer->stream            = stream;
+  lexer->body_unterminated = stream == end;
+}
+
+static bool reflect__lexer_identifier_is_type_keyword(const char* identifier) {
+  return strcmp(identifier, "struct") == 0 || strcmp(identifier, "union") == 0 ||
+         strcmp(identifier, "enum")   == 0 || strcmp(identifier, "typedef") == 0;
+}
+
+static bool reflect__lexer_identifier_is_attribute(const char* identifier) {
+  return strcmp(identifier, "__attribute__") == 0 || strcmp(identifier, "__attribute") == 0 ||
+         strcmp(identifier, "__declspec")    == 0 || strcmp(identifier, "_Alignas")    == 0 ||
+         strcmp(identifier, "alignas")       == 0;
+}
+
+// Follows the file scope tokens of the current declaration, returns true when `token` is a `{`
+// opening a function body.
+//
+// A body has to follow a `)` and the declaration must not have an initializer, which keeps compound
+// literals. Declarations starting with struct, union, enum or typedef additionally need the `)` to
+// close a parameter list right after a name that is not an attribute, so attributed type bodies
+// are kept. Preprocessor directives are their own declaration and end with their line.
+static bool reflect__lexer_declaration_track(ReflectLexer* lexer, const ReflectToken* token) {
+  bool line_start = token->location.line > lexer->previous_line;
+  lexer->previous_line = token->location.line;
+
+  // Directive lines belong to the preprocessor, their tokens, including unbalanced braces in a macro,
+  // leave the declaration and brace state alone.
+  if (lexer->directive_line != 0) {
+    if (token->location.line == lexer->directive_line) {
+      return false;
+    }
+    lexer->directive_line = 0;
+  }
+  if (token->type == REFLECT_TOKEN_HASH && line_start) {
+    lexer->directive_line = token->location.line;
+    return false;
+  }
+
+  ReflectTokenType previous_type = lexer->previous_type;
+  lexer->previous_type = token->type;
+
+  if (lexer->brace_depth > 0) {
+    if (token->type == REFLECT_TOKEN_LBRACE) {
+      lexer->brace_depth++;
+    } else if (token->type == REFLECT_TOKEN_RBRACE) {
+      lexer->brace_depth--;
+    }
+    return false;
+  }
+
+  if (lexer->declaration_start) {
+    lexer->declaration_start  = false;
+    lexer->declaration_type   = token->type == REFLECT_TOKEN_IDENTIFIER &&
+                                reflect__lexer_identifier_is_type_keyword(token->as.identifier);
+    lexer->declaration_assign = false;
+    lexer->paren_depth        = 0;
+  }
+
+  bool previous_attribute = lexer->previous_attribute;
+  lexer->previous_attribute = false;
+  switch (token->type) {
+    case REFLECT_TOKEN_IDENTIFIER:
+      lexer->previous_attribute = reflect__lexer_identifier_is_attribute(token->as.identifier);
+      break;
+    case REFLECT_TOKEN_LPAREN:
+      if (lexer->paren_depth++ == 0) {
+        lexer->paren_call = previous_type == REFLECT_TOKEN_IDENTIFIER && !previous_attribute;
+      }
+      break;
+    case REFLECT_TOKEN_RPAREN:
+      if (lexer->paren_depth > 0) {
+        lexer->paren_depth--;
+      }
+      break;
+    case REFLECT_TOKEN_ASSIGN:
+      lexer->declaration_assign = true;
+      break;
+    case REFLECT_TOKEN_LBRACE:
+      if (
+        previous_type == REFLECT_TOKEN_RPAREN &&
+        lexer->paren_depth == 0               &&
+        !lexer->declaration_assign            &&
+        (!lexer->declaration_type || lexer->paren_call)
+      ) {
+        return true;
+      }
+      lexer->brace_depth++;
+      break;
+    case REFLECT_TOKEN_SEMICOLON:
+    case REFLECT_TOKEN_RBRACE:
+      lexer->declaration_start = true;
+      break;
+    default:
+      break;
+  }
+  return false;
+}
+
+REFLECT_API bool reflect_lexer_token_next(ReflectLexer* lexer, ReflectToken* token) {
+  // The `{` of an unterminated body was already returned, its error is reported on the next call.
+  if (lexer->body_unterminated) {
+    lexer->body_unterminated = false;
+    lexer->error_code        = REFLECT_ERROR_UNTERMINATED_BODY;
+    snprintf(lexer->error_string, REFLECT_LEXER_ERROR_STRING_MAX_LENGTH, "unterminated function body");
+    return false;
+  }
+
+#ifdef REFLECT_LEXER_DFA
+  bool result = reflect_lexer_token_next_dfa(lexer, token);
+#else
+  bool result = reflect_lexer_token_next_switch(lexer, token);
+#endif
+
+  if (lexer->mode != REFLECT_LEXER_MODE_DECLARATIONS || !result) {
+    return result;
+  }
+
+  // The next token is the `}` closing the skipped body.
+  if (reflect__lexer_declaration_track(lexer, token)) {
+    reflect__lexer_body_skip(lexer);
+  }
+  return true;
+}
+
+REFLECT_API bool reflect_token_buffer_lex(ReflectTokenBuffer* buffer, const char* source) {
+  buffer->tokens     = NULL;
+  buffer->count      = 0;
+  buffer->capacity   = 0;
+  buffer->error_code = REFLECT_ERROR_NONE;
+
+  ReflectLexer lexer;
+  ReflectToken token;
+  memset(&token, 0, sizeof(token));
+  reflect_lexer_init(&lexer, source);
+  while (true) {
+    if (!reflect_lexer_token_next(&lexer, &token)) {
+      if (buffer->error_code == REFLECT_ERROR_NONE) {
+        buffer->error_code = reflect_lexer_error_code_get(&lexer);
+      }
+      continue;
+    }
+
+    if (token.type == REFLECT_TOKEN_EOF) {
+      break;
+    }
+
+    if (buffer->count == buffer->capacity) {
+      size_t capacity = buffer->capacity ? buffer->capacity * 2 : 256;
+      ReflectToken* tokens = realloc(buffer->tokens, capacity * sizeof(ReflectToken));
+      if (!tokens) {
+        reflect_token_buffer_free(buffer);
+        return false;
+      }
+      buffer->tokens   = tokens;
+      buffer->capacity = capacity;
+    }
+    buffer->tokens[buffer->count++] = token;
+  }
+
+  return true;
+}
+
+REFLECT_API void reflect_token_buffer_free(ReflectTokenBuffer* buffer) {
+  free(buffer->tokens);
+  buffer->tokens   = NULL;
+  buffer->count    = 0;
+  buffer->capacity = 0;
+}
+
+// FNV-1a, used to spread keys over hash tables.
+static uint64_t reflect__hash_bytes(uint64_t hash, const void* data, size_t size) {
+  const uint8_t* bytes = data;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+#define REFLECT__HASH_SEED 0xcbf29ce484222325ull
+
+static bool reflect__bytes_reserve(ReflectBytes* bytes, size_t size) {
+  if (bytes->size + size <= bytes->capacity) {
+    return true;
+  }
+
+  size_t capacity = bytes->capacity ? bytes->capacity * 2 : 4096;
+  while (capacity < bytes->size + size) {
+    capacity *= 2;
+  }
+  uint8_t* data = realloc(bytes->data, capacity);
+  if (!data) {
+    return false;
+  }
+  bytes->data     = data;
+  bytes->capacity = capacity;
+  return true;
+}
+
+static void reflect__bytes_free(ReflectBytes* bytes) {
+  free(bytes->data);
+  bytes->data     = NULL;
+  bytes->size     = 0;
+  bytes->capacity = 0;
+}
+
+static bool reflect__bytes_push(ReflectBytes* bytes, const void* data, size_t size) {
+  if (!reflect__bytes_reserve(bytes, size)) {
+    return false;
+  }
+  memcpy(bytes->data + bytes->size, data, size);
+  bytes->size += size;
+  return true;
+}
+
+// LEB128, seven bits per byte with the high bit set on every byte but the last.
+static bool reflect__bytes_varint_push(ReflectBytes* bytes, uint64_t value) {
+  if (!reflect__bytes_reserve(bytes, 10)) {
+    return false;
+  }
+  uint8_t* data = bytes->data + bytes->size;
+  while (value >= 0x80) {
+    *data++ = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  *data++     = (uint8_t)value;
+  bytes->size = (size_t)(data - bytes->data);
+  return true;
+}
+
+static uint64_t reflect__varint_read(const uint8_t* data, size_t* offset) {
+  uint8_t byte = data[(*offset)++];
+  if (byte < 0x80) {
+    return byte;
+  }
+
+  uint64_t value = byte & 0x7f;
+  uint32_t shift = 7;
+  do {
+    byte   = data[(*offset)++];
+    value |= (uint64_t)(byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte >= 0x80);
+  return value;
+}
+
+static uint64_t reflect__zigzag_encode(int64_t value) {
+  return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t reflect__zigzag_decode(uint64_t value) {
+  return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+REFLECT_API void reflect_string_table_init(ReflectStringTable* table) {
+  memset(table, 0, sizeof(ReflectStringTable));
+}
+
+REFLECT_API void reflect_string_table_free(ReflectStringTable* table) {
+  reflect__bytes_free(&table->strings);
+  free(table->offsets);
+  free(table->slots);
+  reflect_string_table_init(table);
+}
+
+static uint32_t reflect__string_table_slot(const ReflectStringTable* table, const char* string, size_t length) {
+  uint32_t mask = table->slot_count - 1;
+  uint32_t slot = (uint32_t)reflect__hash_bytes(REFLECT__HASH_SEED, string, length) & mask;
+  while (table->slots[slot]) {
+    const char* candidate = (const char*)table->strings.data + table->offsets[table->slots[slot] - 1];
+    if (strcmp(candidate, string) == 0) {
+      break;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+static bool reflect__string_table_grow(ReflectStringTable* table) {
+  uint32_t  slot_count = table->slot_count ? table->slot_count * 2 : 1024;
+  uint32_t* slots      = calloc(slot_count, sizeof(uint32_t));
+  if (!slots) {
+    return false;
+  }
+
+  uint32_t* old_slots = table->slots;
+  table->slots        = slots;
+  table->slot_count   = slot_count;
+  for (uint32_t id = 0; id < table->count; ++id) {
+    const char* string = (const char*)table->strings.data + table->offsets[id];
+    table->slots[reflect__string_table_slot(table, string, strlen(string))] = id + 1;
+  }
+  free(old_slots);
+  return true;
+}
+
+REFLECT_API bool reflect_string_table_intern(ReflectStringTable* table, const char* string, uint32_t* id) {
+  // Keep the load factor under one half.
+  if ((table->count + 1) * 2 > table->slot_count && !reflect__string_table_grow(table)) {
+    return false;
+  }
+
+  size_t   length = strlen(string);
+  uint32_t slot   = reflect__string_table_slot(table, string, length);
+  if (table->slots[slot]) {
+    *id = table->slots[slot] - 1;
+    return true;
+  }
+
+  if (table->count == table->capacity) {
+    uint32_t  capacity = table->capacity ? table->capacity * 2 : 256;
+    uint32_t* offsets  = realloc(table->offsets, capacity * sizeof(uint32_t));
+    if (!offsets) {
+      return false;
+    }
+    table->offsets  = offsets;
+    table->capacity = capacity;
+  }
+
+  table->offsets[table->count] = (uint32_t)table->strings.size;
+  if (!reflect__bytes_push(&table->strings, string, length + 1)) {
+    return false;
+  }
+  table->slots[slot] = table->count + 1;
+  *id = table->count++;
+  return true;
+}
+
+REFLECT_API bool reflect_string_table_find(const ReflectStringTable* table, const char* string, uint32_t* id) {
+  if (table->count == 0) {
+    return false;
+  }
+  uint32_t slot = reflect__string_table_slot(table, string, strlen(string));
+  if (!table->slots[slot]) {
+    return false;
+  }
+  *id = table->slots[slot] - 1;
+  return true;
+}
+
+REFLECT_API const char* reflect_string_table_get(const ReflectStringTable* table, uint32_t id) {
+  assert(id < table->count);
+  return (const char*)table->strings.data + table->offsets[id];
+}
+
+REFLECT_API void reflect_token_store_init(ReflectTokenStore* store) {
+  memset(store, 0, sizeof(ReflectTokenStore));
+}
+
+REFLECT_API void reflect_token_store_free(ReflectTokenStore* store) {
+  reflect__bytes_free(&store->types);
+  reflect__bytes_free(&store->locations);
+  reflect__bytes_free(&store->values);
+  reflect_string_table_free(&store->strings);
+  free(store->blocks);
+  reflect_token_store_init(store);
+}
+
+REFLECT_API bool reflect_token_store_push(ReflectTokenStore* store, const ReflectToken* token) {
+  assert(token->type < 64 && token->modifier < 4 && "type and modifier are packed in one byte");
+
+  if (store->count % REFLECT_TOKEN_STORE_BLOCK_SIZE == 0) {
+    if (store->block_count == store->block_capacity) {
+      size_t                  capacity = store->block_capacity ? store->block_capacity * 2 : 64;
+      ReflectTokenStoreBlock* blocks   = realloc(store->blocks, capacity * sizeof(ReflectTokenStoreBlock));
+      if (!blocks) {
+        return false;
+      }
+      store->blocks         = blocks;
+      store->block_capacity = capacity;
+    }
+
+    ReflectTokenStoreBlock* block = &store->blocks[store->block_count++];
+    block->location_offset = store->locations.size;
+    block->value_offset    = store->values.size;
+    block->location        = store->location;
+  }
+
+  uint8_t type = (uint8_t)((uint32_t)token->type | (uint32_t)token->modifier << 6);
+  if (!reflect__bytes_push(&store->types, &type, 1)) {
+    return false;
+  }
+
+  // Tokens on the same line store a column delta, the first token of a line its line delta and column.
+  ReflectSourceLocation location = token->location;
+  bool                  result;
+  if (location.line == store->location.line) {
+    int64_t delta = (int64_t)location.column - (int64_t)store->location.column;
+    result = reflect__bytes_varint_push(&store->locations, reflect__zigzag_encode(delta) << 1);
+  } else {
+    int64_t delta = (int64_t)location.line - (int64_t)store->location.line;
+    result = reflect__bytes_varint_push(&store->locations, (uint64_t)location.column << 1 | 1) &&
+             reflect__bytes_varint_push(&store->locations, reflect__zigzag_encode(delta));
+  }
+  if (!result) {
+    return false;
+  }
+  store->location = location;
+
+  uint32_t id;
+  switch (token->type) {
+    case REFLECT_TOKEN_IDENTIFIER:
+      result = reflect_string_table_intern(&store->strings, token->as.identifier, &id) &&
+               reflect__bytes_varint_push(&store->values, id);
+      break;
+    case REFLECT_TOKEN_INTEGER: {
+      char suffix[REFLECT_MAX_SUFFIX_LENGTH + 1];
+      strncpy(suffix, token->suffix_string, REFLECT_MAX_SUFFIX_LENGTH);
+      suffix[REFLECT_MAX_SUFFIX_LENGTH] = '\0';
+      result = reflect_string_table_intern(&store->strings, suffix, &id) &&
+               reflect__bytes_varint_push(&store->values, token->as.integer) &&
+               reflect__bytes_varint_push(&store->values, id);
+    } break;
+    default:
+      break;
+  }
+  if (!result) {
+    return false;
+  }
+
+  store->count++;
+  return true;
+}
+
+REFLECT_API size_t reflect_token_store_size_get(const ReflectTokenStore* store) {
+  return store->types.size
+       + store->locations.size
+       + store->values.size
+       + store->strings.strings.size
+       + store->strings.count * sizeof(uint32_t)
+       + store->strings.slot_count * sizeof(uint32_t)
+       + store->block_count * sizeof(ReflectTokenStoreBlock);
+}
+
+static void reflect__token_store_cursor_location_read(ReflectTokenStoreCursor* cursor) {
+  const uint8_t* data = cursor->store->locations.data;
+  uint64_t       head = reflect__varint_read(data, &cursor->location_offset);
+  if (head & 1) {
+    int64_t delta = reflect__zigzag_decode(reflect__varint_read(data, &cursor->location_offset));
+    cursor->location.line   = (uint32_t)((int64_t)cursor->location.line + delta);
+    cursor->location.column = (uint32_t)(head >> 1);
+  } else {
+    int64_t delta = reflect__zigzag_decode(head >> 1);
+    cursor->location.column = (uint32_t)((int64_t)cursor->location.column + delta);
+  }
+}
+
+REFLECT_API void reflect_token_store_cursor_init(ReflectTokenStoreCursor* cursor, const ReflectTokenStore* store, size_t index) {
+  cursor->store = store;
+  if (index >= store->count) {
+    cursor->index = store->count;
+    return;
+  }
+
+  const ReflectTokenStoreBlock* block = &store->blocks[index / REFLECT_TOKEN_STORE_BLOCK_SIZE];
+  cursor->index           = index - index % REFLECT_TOKEN_STORE_BLOCK_SIZE;
+  cursor->location_offset = block->location_offset;
+  cursor->value_offset    = block->value_offset;
+  cursor->location        = block->location;
+
+  // Skip to the token inside the block, without materializing the skipped ones.
+  for (; cursor->index < index; ++cursor->index) {
+    reflect__token_store_cursor_location_read(cursor);
+    switch ((ReflectTokenType)(store->types.data[cursor->index] & 0x3f)) {
+      case REFLECT_TOKEN_INTEGER:
+        reflect__varint_read(store->values.data, &cursor->value_offset);
+        // fallthrough
+      case REFLECT_TOKEN_IDENTIFIER:
+        reflect__varint_read(store->values.data, &cursor->value_offset);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+REFLECT_API size_t reflect_token_store_cursor_entries_read(ReflectTokenStoreCursor* cursor, ReflectTokenStoreEntry* entries, size_t capacity) {
+  const ReflectTokenStore* store = cursor->store;
+  size_t                   count = store->count - cursor->index;
+  if (count > capacity) {
+    count = capacity;
+  }
+
+  // The whole batch is decoded on locals, the column bytes may alias the cursor and the entries so
+  // writing through them would force reloads after every byte.
+  const uint8_t*        types           = store->types.data + cursor->index;
+  const uint8_t*        locations       = store->locations.data;
+  const uint8_t*        values          = store->values.data;
+  size_t                location_offset = cursor->location_offset;
+  size_t                value_offset    = cursor->value_offset;
+  ReflectSourceLocation location        = cursor->location;
+  for (size_t i = 0; i < count; ++i) {
+    uint64_t head = reflect__varint_read(locations, &location_offset);
+    if (head & 1) {
+      location.line   = (uint32_t)((int64_t)location.line + reflect__zigzag_decode(reflect__varint_read(locations, &location_offset)));
+      location.column = (uint32_t)(head >> 1);
+    } else {
+      location.column = (uint32_t)((int64_t)location.column + reflect__zigzag_decode(head >> 1));
+    }
+
+    ReflectTokenType type    = (ReflectTokenType)(types[i] & 0x3f);
+    uint64_t         integer = 0;
+    uint32_t         string  = 0;
+    switch (type) {
+      case REFLECT_TOKEN_INTEGER:
+        integer = reflect__varint_read(values, &value_offset);
+        // fallthrough
+      case REFLECT_TOKEN_IDENTIFIER:
+        string  = (uint32_t)reflect__varint_read(values, &value_offset);
+        break;
+      default:
+        break;
+    }
+
+    ReflectTokenStoreEntry* entry = &entries[i];
+    entry->type     = type;
+    entry->modifier = (ReflectModifier)(types[i] >> 6);
+    entry->location = location;
+    entry->integer  = integer;
+    entry->string   = string;
+  }
+
+  cursor->index           += count;
+  cursor->location_offset  = location_offset;
+  cursor->value_offset     = value_offset;
+  cursor->location         = location;
+  return count;
+}
+
+REFLECT_API bool reflect_token_store_cursor_next(ReflectTokenStoreCursor* cursor, ReflectToken* token) {
+  ReflectTokenStoreEntry entry;
+  if (reflect_token_store_cursor_entries_read(cursor, &entry, 1) == 0) {
+    return false;
+  }
+
+  token->type             = entry.type;
+  token->modifier         = entry.modifier;
+  token->location         = entry.location;
+  token->suffix_string[0] = '\0';
+  switch (token->type) {
+    case REFLECT_TOKEN_IDENTIFIER:
+      strcpy(token->as.identifier, reflect_string_table_get(&cursor->store->strings, entry.string));
+      break;
+    case REFLECT_TOKEN_INTEGER:
+      token->as.integer = entry.integer;
+      strcpy(token->suffix_string, reflect_string_table_get(&cursor->store->strings, entry.string));
+      break;
+    default:
+      break;
+  }
+  return true;
+}
+
+REFLECT_API bool reflect_token_store_get(const ReflectTokenStore* store, size_t index, ReflectToken* token) {
+  ReflectTokenStoreCursor cursor;
+  reflect_token_store_cursor_init(&cursor, store, index);
+  return reflect_token_store_cursor_next(&cursor, token);
+}
+
+#ifdef REFLECT_POSIX
+
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Reads an open file to its end into a null terminated heap buffer, `capacity` is the expected size.
+static char* reflect__fd_read(int fd, size_t capacity, size_t* size) {
+  char*  content  = malloc(capacity + 1);
+  size_t count    = 0;
+  while (content) {
+    if (count == capacity) {
+      // The file grew since fstat, keep reading until the real end.
+      capacity = capacity * 2 + 4096;
+      char* grown = realloc(content, capacity + 1);
+      if (!grown) {
+        free(content);
+        content = NULL;
+        break;
+      }
+      content = grown;
+    }
+
+    ssize_t result = read(fd, content + count, capacity - count);
+    if (result < 0) {
+      free(content);
+      content = NULL;
+    } else if (result == 0) {
+      content[count] = '\0';
+      break;
+    } else {
+      count += (size_t)result;
+    }
+  }
+
+  if (content && size) {
+    *size = count;
+  }
+  return content;
+}
+
+typedef enum ReflectTokenCacheState {
+  REFLECT__TOKEN_CACHE_PENDING,
+  REFLECT__TOKEN_CACHE_READY,
+  REFLECT__TOKEN_CACHE_FAILED,
+} ReflectTokenCacheState;
+
+struct ReflectTokenCacheEntry {
+  // Everything but `next`, `state` and `buffer` is immutable once the entry is published in a bucket,
+  // `next` only changes under the mutex when a failed entry is unlinked.
+  ReflectTokenCacheEntry* next;
+  ReflectTokenCacheEntry* retired_next;
+  uint64_t                hash;
+  char*                   path;
+  int64_t                 mtime_seconds;
+  int64_t                 mtime_nanoseconds;
+  int64_t                 size;
+
+  int                     state;
+  ReflectTokenBuffer      buffer;
+};
+
+REFLECT_API bool reflect_token_cache_init(ReflectTokenCache* cache) {
+  memset(cache->buckets, 0, sizeof(cache->buckets));
+  cache->retired = NULL;
+  if (pthread_mutex_init(&cache->mutex, NULL) != 0) {
+    return false;
+  }
+  if (pthread_cond_init(&cache->condition, NULL) != 0) {
+    pthread_mutex_destroy(&cache->mutex);
+    return false;
+  }
+  return true;
+}
+
+REFLECT_API void reflect_token_cache_free(ReflectTokenCache* cache) {
+  for (size_t i = 0; i < REFLECT_TOKEN_CACHE_BUCKET_COUNT; ++i) {
+    ReflectTokenCacheEntry* entry = cache->buckets[i];
+    while (entry) {
+      ReflectTokenCacheEntry* next = entry->next;
+      reflect_token_buffer_free(&entry->buffer);
+      free(entry->path);
+      free(entry);
+      entry = next;
+    }
+    cache->buckets[i] = NULL;
+  }
+  while (cache->retired) {
+    ReflectTokenCacheEntry* next = cache->retired->retired_next;
+    free(cache->retired->path);
+    free(cache->retired);
+    cache->retired = next;
+  }
+  pthread_cond_destroy(&cache->condition);
+  pthread_mutex_destroy(&cache->mutex);
+}
+
+static ReflectTokenCacheEntry* reflect__token_cache_find(
+  ReflectTokenCacheEntry* const* bucket,
+  const ReflectTokenCacheEntry*  key
+) {
+  ReflectTokenCacheEntry* entry = __atomic_load_n(bucket, __ATOMIC_ACQUIRE);
+  for (; entry; entry = __atomic_load_n(&entry->next, __ATOMIC_ACQUIRE)) {
+    if (
+      entry->hash              == key->hash              &&
+      entry->size              == key->size              &&
+      entry->mtime_seconds     == key->mtime_seconds     &&
+      entry->mtime_nanoseconds == key->mtime_nanoseconds &&
+      strcmp(entry->path, key->path) == 0
+    ) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+static const ReflectTokenBuffer* reflect__token_cache_wait(ReflectTokenCache* cache, ReflectTokenCacheEntry* entry) {
+  int state = __atomic_load_n(&entry->state, __ATOMIC_ACQUIRE);
+  if (state == REFLECT__TOKEN_CACHE_PENDING) {
+    pthread_mutex_lock(&cache->mutex);
+    while ((state = __atomic_load_n(&entry->state, __ATOMIC_ACQUIRE)) == REFLECT__TOKEN_CACHE_PENDING) {
+      pthread_cond_wait(&cache->condition, &cache->mutex);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+  }
+  return state == REFLECT__TOKEN_CACHE_READY ? &entry->buffer : NULL;
+}
+
+// Takes a failed entry out of its bucket so the next lookup of the file tries again, must hold the mutex.
+// Readers may still be walking through it, so it is only freed with the cache.
+static void reflect__token_cache_unlink(ReflectTokenCache* cache, ReflectTokenCacheEntry** bucket, ReflectTokenCacheEntry* entry) {
+  ReflectTokenCacheEntry** link = bucket;
+  while (*link != entry) {
+    link = &(*link)->next;
+  }
+  __atomic_store_n(link, entry->next, __ATOMIC_RELEASE);
+  entry->retired_next = cache->retired;
+  cache->retired      = entry;
+}
+
+REFLECT_API const ReflectTokenBuffer* reflect_token_cache_get(ReflectTokenCache* cache, const char* path) {
+  ReflectTokenCacheEntry key;
+  key.path = realpath(path, NULL);
+  if (!key.path) {
+    return NULL;
+  }
+
+  // The key comes from the descriptor that is read, so a concurrent write can not pair new content
+  // with an old modification time.
+  struct stat info;
+  int         fd = open(key.path, O_RDONLY);
+  if (fd < 0 || fstat(fd, &info) != 0) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    free(key.path);
+    return NULL;
+  }
+  key.size              = (int64_t)info.st_size;
+  key.mtime_seconds     = (int64_t)info.st_mtim.tv_sec;
+  key.mtime_nanoseconds = (int64_t)info.st_mtim.tv_nsec;
+  key.hash              = reflect__hash_bytes(REFLECT__HASH_SEED, key.path, strlen(key.path));
+  key.hash              = reflect__hash_bytes(key.hash, &key.size, sizeof(key.size));
+  key.hash              = reflect__hash_bytes(key.hash, &key.mtime_seconds, sizeof(key.mtime_seconds));
+  key.hash              = reflect__hash_bytes(key.hash, &key.mtime_nanoseconds, sizeof(key.mtime_nanoseconds));
+
+  ReflectTokenCacheEntry** bucket = &cache->buckets[key.hash % REFLECT_TOKEN_CACHE_BUCKET_COUNT];
+
+  // Fast path: the file was already requested by some thread.
+  ReflectTokenCacheEntry* entry = reflect__token_cache_find(bucket, &key);
+  if (entry) {
+    close(fd);
+    free(key.path);
+    return reflect__token_cache_wait(cache, entry);
+  }
+
+  // Inserts are serialized, so check again under the lock before claiming the file.
+  pthread_mutex_lock(&cache->mutex);
+  entry = reflect__token_cache_find(bucket, &key);
+  if (entry) {
+    pthread_mutex_unlock(&cache->mutex);
+    close(fd);
+    free(key.path);
+    return reflect__token_cache_wait(cache, entry);
+  }
+
+  entry = malloc(sizeof(ReflectTokenCacheEntry));
+  if (!entry) {
+    pthread_mutex_unlock(&cache->mutex);
+    close(fd);
+    free(key.path);
+    return NULL;
+  }
+  *entry              = key;
+  entry->state        = REFLECT__TOKEN_CACHE_PENDING;
+  entry->next         = *bucket;
+  entry->retired_next = NULL;
+  memset(&entry->buffer, 0, sizeof(entry->buffer));
+  __atomic_store_n(bucket, entry, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&cache->mutex);
+
+  // Lex outside of the lock, threads asking for other files are not blocked.
+  int   state  = REFLECT__TOKEN_CACHE_FAILED;
+  char* source = reflect__fd_read(fd, (size_t)info.st_size, NULL);
+  close(fd);
+  if (source) {
+    if (reflect_token_buffer_lex(&entry->buffer, source)) {
+      state = REFLECT__TOKEN_CACHE_READY;
+    }
+    free(source);
+  }
+
+  pthread_mutex_lock(&cache->mutex);
+  if (state == REFLECT__TOKEN_CACHE_FAILED) {
+    // Failures like EMFILE or ENOMEM are usually temporary, they are not cached.
+    reflect__token_cache_unlink(cache, bucket, entry);
+  }
+  __atomic_store_n(&entry->state, state, __ATOMIC_RELEASE);
+  pthread_cond_broadcast(&cache->condition);
+  pthread_mutex_unlock(&cache->mutex);
+
+  return state == REFLECT__TOKEN_CACHE_READY ? &entry->buffer : NULL;
+}
+
+REFLECT_API void reflect_index_init(ReflectIndex* index) {
+  reflect_string_table_init(&index->symbols);
+  reflect_string_table_init(&index->paths);
+  index->files         = NULL;
+  index->file_capacity = 0;
+}
+
+REFLECT_API void reflect_index_free(ReflectIndex* index) {
+  for (uint32_t i = 0; i < index->paths.count; ++i) {
+    reflect__bytes_free(&index->files[i].occurrences);
+  }
+  free(index->files);
+  reflect_string_table_free(&index->symbols);
+  reflect_string_table_free(&index->paths);
+  reflect_index_init(index);
+}
+
+static ReflectIndexFile* reflect__index_file_get(ReflectIndex* index, const char* path) {
+  uint32_t id;
+  if (!reflect_string_table_intern(&index->paths, path, &id)) {
+    return NULL;
+  }
+
+  if (id >= index->file_capacity) {
+    uint32_t          capacity = index->file_capacity ? index->file_capacity * 2 : 64;
+    ReflectIndexFile* files    = realloc(index->files, capacity * sizeof(ReflectIndexFile));
+    if (!files) {
+      return NULL;
+    }
+    memset(files + index->file_capacity, 0, (capacity - index->file_capacity) * sizeof(ReflectIndexFile));
+    index->files         = files;
+    index->file_capacity = capacity;
+  }
+  return &index->files[id];
+}
+
+static bool reflect__index_occurrence_push(ReflectIndexFile* file, uint32_t symbol, ReflectSourceLocation location) {
+  return reflect__bytes_varint_push(&file->occurrences, symbol)        &&
+         reflect__bytes_varint_push(&file->occurrences, location.line) &&
+         reflect__bytes_varint_push(&file->occurrences, location.column);
+}
+
+REFLECT_API bool reflect_index_file_update(ReflectIndex* index, const char* path) {
+  // Stat and read the same descriptor, so a concurrent write can not be stored under the old size and time.
+  struct stat info;
+  int         fd = open(path, O_RDONLY);
+  if (fd < 0 || fstat(fd, &info) != 0) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    reflect_index_file_remove(index, path);
+    return false;
+  }
+
+  ReflectIndexFile* file = reflect__index_file_get(index, path);
+  if (!file) {
+    close(fd);
+    return false;
+  }
+
+  if (
+    file->present                                                   &&
+    file->size              == (int64_t)info.st_size                &&
+    file->mtime_seconds     == (int64_t)info.st_mtim.tv_sec         &&
+    file->mtime_nanoseconds == (int64_t)info.st_mtim.tv_nsec
+  ) {
+    close(fd);
+    return true;
+  }
+
+  file->present          = false;
+  file->occurrences.size = 0;
+
+  char* source = reflect__fd_read(fd, (size_t)info.st_size, NULL);
+  close(fd);
+  if (!source) {
+    return false;
+  }
+
+  ReflectLexer lexer;
+  ReflectToken token;
+  reflect_lexer_init(&lexer, source);
+  bool result = true;
+  while (result) {
+    if (!reflect_lexer_token_next(&lexer, &token)) {
+      continue;
+    }
+    if (token.type == REFLECT_TOKEN_EOF) {
+      break;
+    }
+    if (token.type == REFLECT_TOKEN_IDENTIFIER) {
+      uint32_t symbol;
+      result = reflect_string_table_intern(&index->symbols, token.as.identifier, &symbol) &&
+               reflect__index_occurrence_push(file, symbol, token.location);
+    }
+  }
+  free(source);
+
+  if (!result) {
+    file->occurrences.size = 0;
+    return false;
+  }
+
+  file->present           = true;
+  file->size              = (int64_t)info.st_size;
+  file->mtime_seconds     = (int64_t)info.st_mtim.tv_sec;
+  file->mtime_nanoseconds = (int64_t)info.st_mtim.tv_nsec;
+  return true;
+}
+
+REFLECT_API void reflect_index_file_remove(ReflectIndex* index, const char* path) {
+  uint32_t id;
+  if (reflect_string_table_find(&index->paths, path, &id)) {
+    index->files[id].present = false;
+    reflect__bytes_free(&index->files[id].occurrences);
+  }
+}
+
+// On disk layout, every section starts on an 8 byte boundary:
+//   header | files | symbols | slots | strings | postings
+#define REFLECT__INDEX_MAGIC "RFLIDX01"
+
+typedef struct ReflectIndexHeader {
+  char     magic[8];
+  uint32_t file_count;
+  uint32_t symbol_count;
+  uint32_t slot_count;
+  uint32_t reserved;
+  uint64_t files_offset;
+  uint64_t symbols_offset;
+  uint64_t slots_offset;
+  uint64_t strings_offset;
+  uint64_t postings_offset;
+  uint64_t size;
+} ReflectIndexHeader;
+
+typedef struct ReflectIndexFileRecord {
+  uint64_t path_offset;
+  int64_t  mtime_seconds;
+  int64_t  mtime_nanoseconds;
+  int64_t  size;
+} ReflectIndexFileRecord;
+
+typedef struct ReflectIndexSymbolRecord {
+  uint64_t name_offset;
+  uint64_t postings_offset;
+  uint32_t posting_count;
+  uint32_t reserved;
+} ReflectIndexSymbolRecord;
+
+static bool reflect__bytes_align(ReflectBytes* bytes) {
+  static const uint8_t zeros[8] = { 0 };
+  return reflect__bytes_push(bytes, zeros, (8 - bytes->size % 8) % 8);
+}
+
+static bool reflect__index_postings_encode(ReflectBytes* bytes, const ReflectIndexPosting* postings, uint32_t count) {
+  ReflectIndexPosting previous = { 0 };
+  for (uint32_t i = 0; i < count; ++i) {
+    const ReflectIndexPosting* posting = &postings[i];
+    uint32_t file_delta = posting->file - previous.file;
+    uint32_t line_delta = posting->location.line - previous.location.line;
+    bool     result     = reflect__bytes_varint_push(bytes, file_delta);
+    if (file_delta != 0) {
+      result = result && reflect__bytes_varint_push(bytes, posting->location.line)
+                      && reflect__bytes_varint_push(bytes, posting->location.column);
+    } else if (line_delta != 0) {
+      result = result && reflect__bytes_varint_push(bytes, line_delta)
+                      && reflect__bytes_varint_push(bytes, posting->location.column);
+    } else {
+      result = result && reflect__bytes_varint_push(bytes, 0)
+                      && reflect__bytes_varint_push(bytes, posting->location.column - previous.location.column);
+    }
+    if (!result) {
+      return false;
+    }
+    previous = *posting;
+  }
+  return true;
+}
+
+REFLECT_API bool reflect_index_write(const ReflectIndex* index, const char* path) {
+  uint32_t             symbol_total = index->symbols.count;
+  uint32_t             file_total   = index->paths.count;
+  uint32_t*            counts       = calloc((size_t)symbol_total + 1, sizeof(uint32_t));
+  uint32_t*            starts       = calloc((size_t)symbol_total + 1, sizeof(uint32_t));
+  uint32_t*            file_ids     = calloc((size_t)file_total + 1, sizeof(uint32_t));
+  ReflectIndexPosting* postings     = NULL;
+  uint32_t*            slots        = NULL;
+  ReflectBytes         output       = { 0 };
+  ReflectBytes         strings      = { 0 };
+  ReflectBytes         encoded      = { 0 };
+  bool                 result       = false;
+  FILE*                stream       = NULL;
+  char*                temporary    = malloc(strlen(path) + 5);
+  if (!counts || !starts || !file_ids || !temporary) {
+    goto cleanup;
+  }
+
+  // Count the occurrences of every symbol and number the files that are still present.
+  uint32_t file_count     = 0;
+  size_t   occurrence_all = 0;
+  for (uint32_t id = 0; id < file_total; ++id) {
+    const ReflectIndexFile* file = &index->files[id];
+    file_ids[id] = file->present ? file_count++ : UINT32_MAX;
+    for (size_t offset = 0; file->present && offset < file->occurrences.size; ++occurrence_all) {
+      counts[reflect__varint_read(file->occurrences.data, &offset)]++;
+      reflect__varint_read(file->occurrences.data, &offset);
+      reflect__varint_read(file->occurrences.data, &offset);
+    }
+  }
+
+  // Bucket the occurrences by symbol, walking files in order keeps every bucket sorted.
+  uint32_t symbol_count = 0;
+  for (uint32_t symbol = 0; symbol < symbol_total; ++symbol) {
+    starts[symbol + 1] = starts[symbol] + counts[symbol];
+    symbol_count      += counts[symbol] != 0;
+    counts[symbol]     = 0;
+  }
+  postings = malloc((occurrence_all + 1) * sizeof(ReflectIndexPosting));
+  if (!postings) {
+    goto cleanup;
+  }
+  for (uint32_t id = 0; id < file_total; ++id) {
+    const ReflectIndexFile* file = &index->files[id];
+    for (size_t offset = 0; file->present && offset < file->occurrences.size;) {
+      uint32_t             symbol  = (uint32_t)reflect__varint_read(file->occurrences.data, &offset);
+      ReflectIndexPosting* posting = &postings[starts[symbol] + counts[symbol]++];
+      posting->file            = file_ids[id];
+      posting->location.line   = (uint32_t)reflect__varint_read(file->occurrences.data, &offset);
+      posting->location.column = (uint32_t)reflect__varint_read(file->occurrences.data, &offset);
+    }
+  }
+
+  uint32_t slot_count = 2;
+  while (slot_count < symbol_count * 2) {
+    slot_count *= 2;
+  }
+  slots = calloc(slot_count, sizeof(uint32_t));
+  if (!slots) {
+    goto cleanup;
+  }
+
+  ReflectIndexHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, REFLECT__INDEX_MAGIC, sizeof(header.magic));
+  header.file_count   = file_count;
+  header.symbol_count = symbol_count;
+  header.slot_count   = slot_count;
+
+  header.files_offset   = sizeof(ReflectIndexHeader);
+  header.symbols_offset = header.files_offset + (uint64_t)file_count * sizeof(ReflectIndexFileRecord);
+  header.slots_offset   = header.symbols_offset + (uint64_t)symbol_count * sizeof(ReflectIndexSymbolRecord);
+  header.strings_offset = header.slots_offset + ((uint64_t)slot_count * sizeof(uint32_t) + 7) / 8 * 8;
+  if (!reflect__bytes_reserve(&output, (size_t)header.strings_offset)) {
+    goto cleanup;
+  }
+  output.size = (size_t)header.strings_offset;
+
+  ReflectIndexFileRecord* file_records = (ReflectIndexFileRecord*)(output.data + header.files_offset);
+  for (uint32_t id = 0; id < file_total; ++id) {
+    const ReflectIndexFile* file = &index->files[id];
+    if (!file->present) {
+      continue;
+    }
+    const char*             file_path = reflect_string_table_get(&index->paths, id);
+    ReflectIndexFileRecord* record    = &file_records[file_ids[id]];
+    record->path_offset       = strings.size;
+    record->mtime_seconds     = file->mtime_seconds;
+    record->mtime_nanoseconds = file->mtime_nanoseconds;
+    record->size              = file->size;
+    if (!reflect__bytes_push(&strings, file_path, strlen(file_path) + 1)) {
+      goto cleanup;
+    }
+  }
+
+  ReflectIndexSymbolRecord* symbol_records = (ReflectIndexSymbolRecord*)(output.data + header.symbols_offset);
+  uint32_t                  symbol_id      = 0;
+  for (uint32_t symbol = 0; symbol < symbol_total; ++symbol) {
+    if (counts[symbol] == 0) {
+      continue;
+    }
+
+    const char*               name   = reflect_string_table_get(&index->symbols, symbol);
+    size_t                    length = strlen(name);
+    ReflectIndexSymbolRecord* record = &symbol_records[symbol_id];
+    record->name_offset     = strings.size;
+    record->postings_offset = encoded.size;
+    record->posting_count   = counts[symbol];
+    record->reserved        = 0;
+    if (
+      !reflect__bytes_push(&strings, name, length + 1) ||
+      !reflect__index_postings_encode(&encoded, &postings[starts[symbol]], counts[symbol])
+    ) {
+      goto cleanup;
+    }
+
+    uint32_t slot = (uint32_t)reflect__hash_bytes(REFLECT__HASH_SEED, name, length) & (slot_count - 1);
+    while (slots[slot]) {
+      slot = (slot + 1) & (slot_count - 1);
+    }
+    slots[slot] = ++symbol_id;
+  }
+  memcpy(output.data + header.slots_offset, slots, slot_count * sizeof(uint32_t));
+
+  if (!reflect__bytes_push(&output, strings.data, strings.size) || !reflect__bytes_align(&output)) {
+    goto cleanup;
+  }
+  header.postings_offset = output.size;
+  if (!reflect__bytes_push(&output, encoded.data, encoded.size)) {
+    goto cleanup;
+  }
+  header.size = output.size;
+  memcpy(output.data, &header, sizeof(header));
+
+  // Write next to the destination and rename, readers keep their mapping of the old index.
+  strcpy(temporary, path);
+  strcat(temporary, ".tmp");
+  stream = fopen(temporary, "wb");
+  if (!stream) {
+    goto cleanup;
+  }
+  result = fwrite(output.data, 1, output.size, stream) == output.size;
+  result = fclose(stream) == 0 && result;
+  result = result && rename(temporary, path) == 0;
+  if (!result) {
+    remove(temporary);
+  }
+
+cleanup:
+  free(counts);
+  free(starts);
+  free(file_ids);
+  free(postings);
+  free(slots);
+  free(temporary);
+  reflect__bytes_free(&output);
+  reflect__bytes_free(&strings);
+  reflect__bytes_free(&encoded);
+  return result;
+}
+
+#include <sys/mman.h>
+
+// Like `reflect__varint_read`, but fails instead of reading at or past `size` or overflowing 64 bits.
+static bool reflect__varint_read_checked(const uint8_t* data, size_t size, size_t* offset, uint64_t* value) {
+  uint64_t result = 0;
+  for (uint32_t shift = 0; shift < 64 && *offset < size; shift += 7) {
+    uint8_t byte = data[(*offset)++];
+    result |= (uint64_t)(byte & 0x7f) << shift;
+    if (byte < 0x80) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+static const ReflectIndexHeader* reflect__index_view_header(const ReflectIndexView* view) {
+  return (const ReflectIndexHeader*)view->data;
+}
+
+static const char* reflect__index_view_string(const ReflectIndexView* view, uint64_t offset) {
+  return (const char*)view->data + reflect__index_view_header(view)->strings_offset + offset;
+}
+
+// Checks that every section and offset of a mapped index stays inside the file, so a stale, foreign
+// or corrupted index is rejected when it is opened instead of being read out of bounds later.
+static bool reflect__index_view_validate(const uint8_t* data, size_t size) {
+  const ReflectIndexHeader* header = (const ReflectIndexHeader*)data;
+  if (
+    memcmp(header->magic, REFLECT__INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+    header->size            != size                                         ||
+    header->files_offset    <  sizeof(ReflectIndexHeader)                   ||
+    header->files_offset    >  size || header->files_offset   % 8 != 0      ||
+    header->symbols_offset  >  size || header->symbols_offset % 8 != 0      ||
+    header->slots_offset    >  size || header->slots_offset   % 8 != 0      ||
+    header->strings_offset  >  size                                         ||
+    header->postings_offset >  size                                         ||
+    header->files_offset   + (uint64_t)header->file_count   * sizeof(ReflectIndexFileRecord)   > header->symbols_offset ||
+    header->symbols_offset + (uint64_t)header->symbol_count * sizeof(ReflectIndexSymbolRecord) > header->slots_offset   ||
+    header->slots_offset   + (uint64_t)header->slot_count   * sizeof(uint32_t)                 > header->strings_offset ||
+    header->strings_offset > header->postings_offset                        ||
+    header->slot_count <= header->symbol_count                              ||
+    (header->slot_count & (header->slot_count - 1)) != 0
+  ) {
+    return false;
+  }
+
+  // Every slot points at a symbol and at least one is empty, so probing always ends.
+  const uint32_t* slots = (const uint32_t*)(data + header->slots_offset);
+  uint32_t        empty = 0;
+  for (uint32_t slot = 0; slot < header->slot_count; ++slot) {
+    if (slots[slot] > header->symbol_count) {
+      return false;
+    }
+    empty += slots[slot] == 0;
+  }
+  if (empty == 0) {
+    return false;
+  }
+
+  // Strings are only looked up by offset, a null byte closing the section keeps all of them inside it.
+  uint64_t strings_size = header->postings_offset - header->strings_offset;
+  if (strings_size > 0 && data[header->postings_offset - 1] != '\0') {
+    return false;
+  }
+
+  const ReflectIndexFileRecord* files = (const ReflectIndexFileRecord*)(data + header->files_offset);
+  for (uint32_t file = 0; file < header->file_count; ++file) {
+    if (files[file].path_offset >= strings_size) {
+      return false;
+    }
+  }
+
+  const ReflectIndexSymbolRecord* symbols       = (const ReflectIndexSymbolRecord*)(data + header->symbols_offset);
+  uint64_t                        postings_size = size - header->postings_offset;
+  for (uint32_t symbol = 0; symbol < header->symbol_count; ++symbol) {
+    if (symbols[symbol].name_offset >= strings_size || symbols[symbol].postings_offset > postings_size) {
+      return false;
+    }
+  }
+  return true;
+}
+
+REFLECT_API bool reflect_index_view_open(ReflectIndexView* view, const char* path) {
+  view->data = NULL;
+  view->size = 0;
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(ReflectIndexHeader)) {
+    close(fd);
+    return false;
+  }
+
+  size_t size = (size_t)info.st_size;
+  void*  data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+
+  if (!reflect__index_view_validate(data, size)) {
+    munmap(data, size);
+    return false;
+  }
+
+  view->data = data;
+  view->size = size;
+  return true;
+}
+
+REFLECT_API void reflect_index_view_close(ReflectIndexView* view) {
+  if (view->data) {
+    munmap((void*)(uintptr_t)view->data, view->size);
+  }
+  view->data = NULL;
+  view->size = 0;
+}
+
+REFLECT_API uint32_t reflect_index_view_file_count_get(const ReflectIndexView* view) {
+  return reflect__index_view_header(view)->file_count;
+}
+
+REFLECT_API const char* reflect_index_view_file_path_get(const ReflectIndexView* view, uint32_t file) {
+  const ReflectIndexHeader*     header  = reflect__index_view_header(view);
+  const ReflectIndexFileRecord* records = (const ReflectIndexFileRecord*)(view->data + header->files_offset);
+  assert(file < header->file_count);
+  return reflect__index_view_string(view, records[file].path_offset);
+}
+
+// Starts an iterator over the postings of `record`, or an empty one when it is NULL.
+static void reflect__index_view_iterator_init(
+  const ReflectIndexView*         view,
+  const ReflectIndexSymbolRecord* record,
+  ReflectIndexIterator*           iterator
+) {
+  const ReflectIndexHeader* header = reflect__index_view_header(view);
+  memset(iterator, 0, sizeof(ReflectIndexIterator));
+  iterator->data       = view->data + header->postings_offset;
+  iterator->size       = view->size - (size_t)header->postings_offset;
+  iterator->file_count = header->file_count;
+  if (record) {
+    iterator->offset    = (size_t)record->postings_offset;
+    iterator->remaining = record->posting_count;
+  }
+}
+
+// Returns the number of postings of `symbol`, zero when it does not occur anywhere.
+REFLECT_API uint32_t reflect_index_view_find(const ReflectIndexView* view, const char* symbol, ReflectIndexIterator* iterator) {
+  const ReflectIndexHeader*       header  = reflect__index_view_header(view);
+  const ReflectIndexSymbolRecord* records = (const ReflectIndexSymbolRecord*)(view->data + header->symbols_offset);
+  const uint32_t*                 slots   = (const uint32_t*)(view->data + header->slots_offset);
+
+  reflect__index_view_iterator_init(view, NULL, iterator);
+
+  uint32_t mask = header->slot_count - 1;
+  uint32_t slot = (uint32_t)reflect__hash_bytes(REFLECT__HASH_SEED, symbol, strlen(symbol)) & mask;
+  for (; slots[slot]; slot = (slot + 1) & mask) {
+    const ReflectIndexSymbolRecord* record = &records[slots[slot] - 1];
+    if (strcmp(reflect__index_view_string(view, record->name_offset), symbol) == 0) {
+      reflect__index_view_iterator_init(view, record, iterator);
+      return record->posting_count;
+    }
+  }
+  return 0;
+}
+
+REFLECT_API bool reflect_index_iterator_next(ReflectIndexIterator* iterator, ReflectIndexPosting* posting) {
+  if (iterator->remaining == 0) {
+    return false;
+  }
+
+  // A truncated posting or one past the last file stops the iteration, `remaining` stays non zero.
+  size_t   offset = iterator->offset;
+  uint64_t file_delta;
+  uint64_t line;
+  uint64_t column;
+  if (
+    !reflect__varint_read_checked(iterator->data, iterator->size, &offset, &file_delta) ||
+    !reflect__varint_read_checked(iterator->data, iterator->size, &offset, &line)       ||
+    !reflect__varint_read_checked(iterator->data, iterator->size, &offset, &column)     ||
+    file_delta >= (uint64_t)iterator->file_count - iterator->posting.file              ||
+    line > UINT32_MAX || column > UINT32_MAX
+  ) {
+    return false;
+  }
+  iterator->offset = offset;
+  iterator->remaining--;
+
+  ReflectIndexPosting* previous = &iterator->posting;
+  if (file_delta != 0) {
+    previous->file            += (uint32_t)file_delta;
+    previous->location.line    = (uint32_t)line;
+    previous->location.column  = (uint32_t)column;
+  } else if (line != 0) {
+    previous->location.line   += (uint32_t)line;
+    previous->location.column  = (uint32_t)column;
+  } else {
+    previous->location.column += (uint32_t)column;
+  }
+
+  *posting = *previous;
+  return true;
+}
+
+// Loads an index file written by `reflect_index_write` into an empty index, so later updates only
+// lex the files that changed since it was written.
+REFLECT_API bool reflect_index_read(ReflectIndex* index, const char* path) {
+  ReflectIndexView view;
+  if (!reflect_index_view_open(&view, path)) {
+    return false;
+  }
+
+  const ReflectIndexHeader*       header  = reflect__index_view_header(&view);
+  const ReflectIndexFileRecord*   files   = (const ReflectIndexFileRecord*)(view.data + header->files_offset);
+  const ReflectIndexSymbolRecord* symbols = (const ReflectIndexSymbolRecord*)(view.data + header->symbols_offset);
+  bool                            result  = true;
+
+  uint32_t* file_ids = malloc(((size_t)header->file_count + 1) * sizeof(uint32_t));
+  result = file_ids != NULL;
+  for (uint32_t i = 0; result && i < header->file_count; ++i) {
+    const char*       file_path = reflect__index_view_string(&view, files[i].path_offset);
+    ReflectIndexFile* file      = reflect__index_file_get(index, file_path);
+    if (!file) {
+      result = false;
+      break;
+    }
+    reflect_string_table_find(&index->paths, file_path, &file_ids[i]);
+    file->present           = true;
+    file->size              = files[i].size;
+    file->mtime_seconds     = files[i].mtime_seconds;
+    file->mtime_nanoseconds = files[i].mtime_nanoseconds;
+    file->occurrences.size  = 0;
+  }
+
+  for (uint32_t i = 0; result && i < header->symbol_count; ++i) {
+    uint32_t symbol;
+    if (!reflect_string_table_intern(&index->symbols, reflect__index_view_string(&view, symbols[i].name_offset), &symbol)) {
+      result = false;
+      break;
+    }
+
+    ReflectIndexIterator iterator;
+    ReflectIndexPosting  posting;
+    reflect__index_view_iterator_init(&view, &symbols[i], &iterator);
+    while (result && reflect_index_iterator_next(&iterator, &posting)) {
+      result = posting.file < header->file_count &&
+               reflect__index_occurrence_push(&index->files[file_ids[posting.file]], symbol, posting.location);
+    }
+    result = result && iterator.remaining == 0;
+  }
+
+  free(file_ids);
+  reflect_index_view_close(&view);
+  return result;
+}
+
+REFLECT_API void reflect_pipeline_options_default(ReflectPipelineOptions* options) {
+  options->backend         = REFLECT_PIPELINE_BACKEND_AUTO;
+  options->buffer_count    = 16;
+  options->buffer_size     = 256 * 1024;
+  options->buffer_size_max = 64 * 1024 * 1024;
+  options->reader_count    = 4;
+  options->worker_count    = 4;
+}
+
+#define REFLECT__PIPELINE_ALIGNMENT 4096
+
+typedef struct ReflectPipelineBuffer {
+  char*  data;
+  size_t capacity;
+  size_t size;
+  size_t expected;
+  size_t path_index;
+  int    fd;
+  int    error;
+} ReflectPipelineBuffer;
+
+// Ring of buffer indices, it can hold every buffer of the pool so pushing never blocks.
+typedef struct ReflectPipelineQueue {
+  uint32_t* items;
+  uint32_t  capacity;
+  uint32_t  head;
+  uint32_t  count;
+} ReflectPipelineQueue;
+
+typedef struct ReflectPipeline {
+  const ReflectPipelineOptions* options;
+  const char* const*            paths;
+  size_t                        path_count;
+  ReflectPipelineCallback       callback;
+  void*                         user_data;
+
+  ReflectPipelineBuffer*        buffers;
+  ReflectPipelineQueue          free;
+  ReflectPipelineQueue          ready;
+  size_t                        next_path;
+  bool                          reading_done;
+  // Set when reads may still be in flight after the run, their buffers are then never freed.
+  bool                          buffers_leaked;
+
+  pthread_mutex_t               mutex;
+  pthread_cond_t                free_available;
+  pthread_cond_t                ready_available;
+} ReflectPipeline;
+
+static void reflect__pipeline_queue_push(ReflectPipelineQueue* queue, uint32_t index) {
+  assert(queue->count < queue->capacity);
+  queue->items[(queue->head + queue->count++) % queue->capacity] = index;
+}
+
+static uint32_t reflect__pipeline_queue_pop(ReflectPipelineQueue* queue) {
+  assert(queue->count > 0);
+  uint32_t index = queue->items[queue->head];
+  queue->head    = (queue->head + 1) % queue->capacity;
+  queue->count--;
+  return index;
+}
+
+static bool reflect__pipeline_buffer_acquire(ReflectPipeline* pipeline, bool wait, uint32_t* index) {
+  pthread_mutex_lock(&pipeline->mutex);
+  while (wait && pipeline->free.count == 0) {
+    pthread_cond_wait(&pipeline->free_available, &pipeline->mutex);
+  }
+  bool result = pipeline->free.count > 0;
+  if (result) {
+    *index = reflect__pipeline_queue_pop(&pipeline->free);
+  }
+  pthread_mutex_unlock(&pipeline->mutex);
+  return result;
+}
+
+static void reflect__pipeline_buffer_release(ReflectPipeline* pipeline, uint32_t index) {
+  pthread_mutex_lock(&pipeline->mutex);
+  reflect__pipeline_queue_push(&pipeline->free, index);
+  pthread_cond_signal(&pipeline->free_available);
+  pthread_mutex_unlock(&pipeline->mutex);
+}
+
+static void reflect__pipeline_buffer_publish(ReflectPipeline* pipeline, uint32_t index) {
+  ReflectPipelineBuffer* buffer = &pipeline->buffers[index];
+  if (buffer->fd >= 0) {
+    close(buffer->fd);
+    buffer->fd = -1;
+  }
+  if (buffer->error == 0) {
+    buffer->data[buffer->size] = '\0';
+  }
+
+  pthread_mutex_lock(&pipeline->mutex);
+  reflect__pipeline_queue_push(&pipeline->ready, index);
+  pthread_cond_signal(&pipeline->ready_available);
+  pthread_mutex_unlock(&pipeline->mutex);
+}
+
+// Opens the file of the buffer and makes room for its whole content, `error` is set on failure.
+static bool reflect__pipeline_buffer_open(ReflectPipeline* pipeline, ReflectPipelineBuffer* buffer, size_t path_index) {
+  buffer->path_index = path_index;
+  buffer->size       = 0;
+  buffer->expected   = 0;
+  buffer->error      = 0;
+  buffer->fd         = open(pipeline->paths[path_index], O_RDONLY);
+  if (buffer->fd < 0) {
+    buffer->error = errno;
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(buffer->fd, &info) != 0) {
+    buffer->error = errno;
+    return false;
+  }
+  buffer->expected = (size_t)info.st_size;
+
+  if (buffer->expected + 1 > buffer->capacity) {
+    size_t capacity = (buffer->expected + REFLECT__PIPELINE_ALIGNMENT) / REFLECT__PIPELINE_ALIGNMENT * REFLECT__PIPELINE_ALIGNMENT;
+    size_t maximum  = pipeline->options->buffer_size_max;
+    if (maximum && capacity > maximum) {
+      buffer->error = EFBIG;
+      return false;
+    }
+
+    void*  data     = NULL;
+    free(buffer->data);
+    buffer->data     = NULL;
+    buffer->capacity = 0;
+    if (posix_memalign(&data, REFLECT__PIPELINE_ALIGNMENT, capacity) != 0) {
+      buffer->error = ENOMEM;
+      return false;
+    }
+    buffer->data     = data;
+    buffer->capacity = capacity;
+  }
+  return true;
+}
+
+static void* reflect__pipeline_reader(void* argument) {
+  ReflectPipeline* pipeline = argument;
+  while (true) {
+    pthread_mutex_lock(&pipeline->mutex);
+    size_t path_index = pipeline->next_path;
+    if (path_index < pipeline->path_count) {
+      pipeline->next_path++;
+    }
+    pthread_mutex_unlock(&pipeline->mutex);
+    if (path_index >= pipeline->path_count) {
+      break;
+    }
+
+    uint32_t index;
+    reflect__pipeline_buffer_acquire(pipeline, true, &index);
+    ReflectPipelineBuffer* buffer = &pipeline->buffers[index];
+    if (reflect__pipeline_buffer_open(pipeline, buffer, path_index)) {
+      while (buffer->size < buffer->expected) {
+        ssize_t result = pread(buffer->fd, buffer->data + buffer->size, buffer->expected - buffer->size, (off_t)buffer->size);
+        if (result < 0 && errno == EINTR) {
+          continue;
+        }
+        if (result < 0) {
+          buffer->error = errno;
+        }
+        if (result <= 0) {
+          break;
+        }
+        buffer->size += (size_t)result;
+      }
+    }
+    reflect__pipeline_buffer_publish(pipeline, index);
+  }
+  return NULL;
+}
+
+static void* reflect__pipeline_worker(void* argument) {
+  ReflectPipeline* pipeline = argument;
+  while (true) {
+    pthread_mutex_lock(&pipeline->mutex);
+    while (pipeline->ready.count == 0 && !pipeline->reading_done) {
+      pthread_cond_wait(&pipeline->ready_available, &pipeline->mutex);
+    }
+    if (pipeline->ready.count == 0) {
+      pthread_mutex_unlock(&pipeline->mutex);
+      break;
+    }
+    uint32_t index = reflect__pipeline_queue_pop(&pipeline->ready);
+    pthread_mutex_unlock(&pipeline->mutex);
+
+    ReflectPipelineBuffer* buffer = &pipeline->buffers[index];
+    pipeline->callback(
+      pipeline->user_data,
+      pipeline->paths[buffer->path_index],
+      buffer->error ? NULL : buffer->data,
+      buffer->size,
+      buffer->error
+    );
+    reflect__pipeline_buffer_release(pipeline, index);
+  }
+  return NULL;
+}
+
+static bool reflect__pipeline_threads_run(ReflectPipeline* pipeline) {
+  uint32_t   count   = pipeline->options->reader_count ? pipeline->options->reader_count : 1;
+  pthread_t* readers = malloc(count * sizeof(pthread_t));
+  uint32_t   created = 0;
+  while (readers && created < count && pthread_create(&readers[created], NULL, reflect__pipeline_reader, pipeline) == 0) {
+    created++;
+  }
+
+  // Without any reader thread the calling thread reads everything itself.
+  if (created == 0) {
+    reflect__pipeline_reader(pipeline);
+  }
+  for (uint32_t i = 0; i < created; ++i) {
+    pthread_join(readers[i], NULL);
+  }
+  free(readers);
+  return true;
+}
+
+#if defined(REFLECT_IO_URING) && defined(__linux__)
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+
+typedef struct ReflectUring {
+  int                  fd;
+  unsigned*            sq_tail;
+  unsigned*            sq_mask;
+  unsigned*            sq_array;
+  unsigned*            cq_head;
+  unsigned*            cq_tail;
+  unsigned*            cq_mask;
+  struct io_uring_sqe* sqes;
+  struct io_uring_cqe* cqes;
+  void*                sq_ring;
+  size_t               sq_ring_size;
+  void*                cq_ring;
+  size_t               cq_ring_size;
+  size_t               sqes_size;
+} ReflectUring;
+
+static void reflect__uring_free(ReflectUring* ring) {
+  if (ring->sqes) {
+    munmap(ring->sqes, ring->sqes_size);
+  }
+  if (ring->cq_ring && ring->cq_ring != ring->sq_ring) {
+    munmap(ring->cq_ring, ring->cq_ring_size);
+  }
+  if (ring->sq_ring) {
+    munmap(ring->sq_ring, ring->sq_ring_size);
+  }
+  if (ring->fd >= 0) {
+    close(ring->fd);
+  }
+}
+
+static bool reflect__uring_init(ReflectUring* ring, uint32_t entries) {
+  memset(ring, 0, sizeof(ReflectUring));
+
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+  if (ring->fd < 0) {
+    return false;
+  }
+
+  ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    if (ring->cq_ring_size > ring->sq_ring_size) {
+      ring->sq_ring_size = ring->cq_ring_size;
+    }
+    ring->cq_ring_size = ring->sq_ring_size;
+  }
+
+  ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, IORING_OFF_SQ_RING);
+  if (ring->sq_ring == MAP_FAILED) {
+    ring->sq_ring = NULL;
+    reflect__uring_free(ring);
+    return false;
+  }
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->cq_ring = ring->sq_ring;
+  } else {
+    ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cq_ring == MAP_FAILED) {
+      ring->cq_ring = NULL;
+      reflect__uring_free(ring);
+      return false;
+    }
+  }
+
+  ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes      = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, IORING_OFF_SQES);
+  if (ring->sqes == MAP_FAILED) {
+    ring->sqes = NULL;
+    reflect__uring_free(ring);
+    return false;
+  }
+
+  uint8_t* sq = ring->sq_ring;
+  uint8_t* cq = ring->cq_ring;
+  ring->sq_tail  = (unsigned*)(void*)(sq + params.sq_off.tail);
+  ring->sq_mask  = (unsigned*)(void*)(sq + params.sq_off.ring_mask);
+  ring->sq_array = (unsigned*)(void*)(sq + params.sq_off.array);
+  ring->cq_head  = (unsigned*)(void*)(cq + params.cq_off.head);
+  ring->cq_tail  = (unsigned*)(void*)(cq + params.cq_off.tail);
+  ring->cq_mask  = (unsigned*)(void*)(cq + params.cq_off.ring_mask);
+  ring->cqes     = (struct io_uring_cqe*)(void*)(cq + params.cq_off.cqes);
+  return true;
+}
+
+// Queues a read of the rest of the buffer's file, it is handed to the kernel by the next enter.
+static void reflect__uring_read_queue(ReflectUring* ring, ReflectPipelineBuffer* buffer, uint32_t index) {
+  unsigned             tail = *ring->sq_tail;
+  unsigned             slot = tail & *ring->sq_mask;
+  struct io_uring_sqe* sqe  = &ring->sqes[slot];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode    = IORING_OP_READ;
+  sqe->fd        = buffer->fd;
+  sqe->addr      = (uint64_t)(uintptr_t)(buffer->data + buffer->size);
+  sqe->len       = (uint32_t)(buffer->expected - buffer->size);
+  sqe->off       = (uint64_t)buffer->size;
+#ifdef REFLECT__PIPELINE_URING_READ_MAX
+  // Test hook, forces short reads so resubmission is exercised.
+  if (sqe->len > REFLECT__PIPELINE_URING_READ_MAX) {
+    sqe->len = REFLECT__PIPELINE_URING_READ_MAX;
+  }
+#endif
+  sqe->user_data = index;
+  ring->sq_array[slot] = slot;
+  __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+static bool reflect__pipeline_uring_run(ReflectPipeline* pipeline, ReflectUring* ring) {
+  uint32_t inflight = 0;
+  uint32_t queued   = 0;
+  size_t   next     = 0;
+  bool     failed   = false;
+
+  // After a failed enter nothing new is submitted, the loop only waits for the reads the kernel
+  // still owns so their buffers are not freed under it.
+  while (failed ? inflight > 0 : next < pipeline->path_count || inflight + queued > 0) {
+    // Keep as many reads in flight as there are free buffers, only block when nothing is pending.
+    uint32_t index;
+    while (!failed && next < pipeline->path_count && reflect__pipeline_buffer_acquire(pipeline, inflight + queued == 0, &index)) {
+      ReflectPipelineBuffer* buffer = &pipeline->buffers[index];
+      if (!reflect__pipeline_buffer_open(pipeline, buffer, next++) || buffer->expected == 0) {
+        reflect__pipeline_buffer_publish(pipeline, index);
+        continue;
+      }
+      reflect__uring_read_queue(ring, buffer, index);
+      queued++;
+    }
+
+    if (inflight + queued == 0) {
+      continue;
+    }
+
+    uint32_t submit = failed ? 0 : queued;
+    long     result = syscall(__NR_io_uring_enter, ring->fd, submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    if (result < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+        continue;
+      }
+      if (failed) {
+        pipeline->buffers_leaked = inflight > 0;
+        return false;
+      }
+      failed = true;
+      continue;
+    }
+    inflight += (uint32_t)result;
+    queued   -= (uint32_t)result;
+
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+      struct io_uring_cqe*   cqe    = &ring->cqes[head & *ring->cq_mask];
+      uint32_t               slot   = (uint32_t)cqe->user_data;
+      ReflectPipelineBuffer* buffer = &pipeline->buffers[slot];
+      inflight--;
+      if (cqe->res < 0) {
+        buffer->error = -cqe->res;
+      } else if (cqe->res > 0) {
+        buffer->size += (size_t)cqe->res;
+        if (buffer->size < buffer->expected && !failed) {
+          reflect__uring_read_queue(ring, buffer, slot);
+          queued++;
+          continue;
+        }
+      }
+      reflect__pipeline_buffer_publish(pipeline, slot);
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+  }
+  return !failed;
+}
+
+#endif // REFLECT_IO_URING
+
+REFLECT_API bool reflect_pipeline_run(
+  const ReflectPipelineOptions* options,
+  const char* const*            paths,
+  size_t                        path_count,
+  ReflectPipelineCallback       callback,
+  void*                         user_data,
+  ReflectPipelineBackend*       backend
+) {
+  ReflectPipeline pipeline;
+  memset(&pipeline, 0, sizeof(pipeline));
+  pipeline.options    = options;
+  pipeline.paths      = paths;
+  pipeline.path_count = path_count;
+  pipeline.callback   = callback;
+  pipeline.user_data  = user_data;
+
+  uint32_t buffer_count = options->buffer_count ? options->buffer_count : 1;
+  pipeline.buffers        = calloc(buffer_count, sizeof(ReflectPipelineBuffer));
+  pipeline.free.items     = malloc(buffer_count * sizeof(uint32_t));
+  pipeline.free.capacity  = buffer_count;
+  pipeline.ready.items    = malloc(buffer_count * sizeof(uint32_t));
+  pipeline.ready.capacity = buffer_count;
+
+  uint32_t   worker_count = options->worker_count ? options->worker_count : 1;
+  pthread_t* workers      = malloc(worker_count * sizeof(pthread_t));
+  uint32_t   created      = 0;
+  int        error        = 0;
+  bool       result       = pipeline.buffers && pipeline.free.items && pipeline.ready.items && workers;
+
+  for (uint32_t i = 0; result && i < buffer_count; ++i) {
+    ReflectPipelineBuffer* buffer = &pipeline.buffers[i];
+    void*                  data   = NULL;
+    buffer->fd = -1;
+    if (options->buffer_size && posix_memalign(&data, REFLECT__PIPELINE_ALIGNMENT, options->buffer_size) == 0) {
+      buffer->data     = data;
+      buffer->capacity = options->buffer_size;
+    }
+    reflect__pipeline_queue_push(&pipeline.free, i);
+  }
+
+  if (!result) {
+    goto cleanup;
+  }
+  pthread_mutex_init(&pipeline.mutex, NULL);
+  pthread_cond_init(&pipeline.free_available, NULL);
+  pthread_cond_init(&pipeline.ready_available, NULL);
+
+  while (created < worker_count && pthread_create(&workers[created], NULL, reflect__pipeline_worker, &pipeline) == 0) {
+    created++;
+  }
+
+  ReflectPipelineBackend used = REFLECT_PIPELINE_BACKEND_THREADS;
+  if (created == 0) {
+    result = false;
+  } else {
+#if defined(REFLECT_IO_URING) && defined(__linux__)
+    ReflectUring ring;
+    if (options->backend != REFLECT_PIPELINE_BACKEND_THREADS && reflect__uring_init(&ring, buffer_count)) {
+      used   = REFLECT_PIPELINE_BACKEND_IO_URING;
+      result = reflect__pipeline_uring_run(&pipeline, &ring);
+      reflect__uring_free(&ring);
+    } else
+#endif
+    if (options->backend == REFLECT_PIPELINE_BACKEND_IO_URING) {
+      result = false;
+      error  = ENOSYS;
+    } else {
+      result = reflect__pipeline_threads_run(&pipeline);
+    }
+  }
+
+  pthread_mutex_lock(&pipeline.mutex);
+  pipeline.reading_done = true;
+  pthread_cond_broadcast(&pipeline.ready_available);
+  pthread_mutex_unlock(&pipeline.mutex);
+  for (uint32_t i = 0; i < created; ++i) {
+    pthread_join(workers[i], NULL);
+  }
+
+  pthread_cond_destroy(&pipeline.ready_available);
+  pthread_cond_destroy(&pipeline.free_available);
+  pthread_mutex_destroy(&pipeline.mutex);
+  if (backend) {
+    *backend = used;
+  }
+
+cleanup:
+  for (uint32_t i = 0; pipeline.buffers && i < buffer_count; ++i) {
+    if (pipeline.buffers[i].fd >= 0) {
+      close(pipeline.buffers[i].fd);
+    }
+    if (!pipeline.buffers_leaked) {
+      free(pipeline.buffers[i].data);
+    }
+  }
+  free(pipeline.buffers);
+  free(pipeline.free.items);
+  free(pipeline.ready.items);
+  free(workers);
+  if (error) {
+    errno = error;
+  }
+  return result;
+}
+
+#endif // REFLECT_POSIX
+
 
 #endif // REFLECT_IMPLEMENTATION
 #endif // reflect__H_
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define REFLECT_IMPLEMENTATION
+#define REFLECT_POSIX
+#include "../reflect.h"
+
+#define THREAD_COUNT 8
+
+static bool silent = true;
+
+static char directory[] = "/tmp/reflect_cache_XXXXXX";
+
+typedef struct CacheTestThread {
+  pthread_t                 thread;
+  ReflectTokenCache*        cache;
+  const char*               path;
+  const ReflectTokenBuffer* result;
+} CacheTestThread;
+
+static void* cache_test_thread(void* argument) {
+  CacheTestThread* thread = argument;
+  thread->result = reflect_token_cache_get(thread->cache, thread->path);
+  return NULL;
+}
+
+static void file_write(const char* path, const char* content) {
+  FILE* file = fopen(path, "w");
+  assert(file && "could not create test file");
+  fputs(content, file);
+  fclose(file);
+}
+
+static void path_make(char* path, size_t size, const char* name) {
+  snprintf(path, size, "%s/%s", directory, name);
+}
+
+void cache_sharing_tests(ReflectTokenCache* cache) {
+  printf("  Running Test: Concurrent Lookups Share One Buffer\n");
+
+  char path[256];
+  char alias[256];
+  path_make(path, sizeof(path), "common.h");
+  snprintf(alias, sizeof(alias), "%s/./common.h", directory);
+  file_write(path, "struct Vector { int x ; int y ; } ;");
+
+  CacheTestThread threads[THREAD_COUNT];
+  for (size_t i = 0; i < THREAD_COUNT; ++i) {
+    threads[i].cache  = cache;
+    threads[i].path   = i % 2 ? path : alias;
+    threads[i].result = NULL;
+    pthread_create(&threads[i].thread, NULL, cache_test_thread, &threads[i]);
+  }
+  for (size_t i = 0; i < THREAD_COUNT; ++i) {
+    pthread_join(threads[i].thread, NULL);
+  }
+
+  int assertion = 1;
+  for (size_t i = 0; i < THREAD_COUNT; ++i, ++assertion) {
+    if (threads[i].result == NULL || threads[i].result != threads[0].result) {
+      printf("    Assertion #%d: FAILED - thread %zu got a different buffer\n", assertion, i);
+      return;
+    }
+  }
+
+  const ReflectTokenBuffer* buffer = threads[0].result;
+  if (buffer->count != 11) {
+    printf("    Assertion #%d: FAILED - expected 11 tokens, got %zu\n", assertion, buffer->count);
+    return;
+  }
+  assertion++;
+
+  if (buffer->tokens[1].type != REFLECT_TOKEN_IDENTIFIER || strcmp(buffer->tokens[1].as.identifier, "Vector") != 0) {
+    printf("    Assertion #%d: FAILED - expected identifier \"Vector\"\n", assertion);
+    return;
+  }
+
+  if (!silent) {
+    printf("    All Test Assertions Passed!\n");
+  }
+}
+
+void cache_invalidation_tests(ReflectTokenCache* cache) {
+  printf("  Running Test: Modified Files Get A New Buffer\n");
+
+  char path[256];
+  path_make(path, sizeof(path), "changing.h");
+  file_write(path, "int a ;");
+
+  const ReflectTokenBuffer* before = reflect_token_cache_get(cache, path);
+  if (!before || before->count != 3) {
+    printf("    Assertion #1: FAILED - could not lex the original file\n");
+    return;
+  }
+
+  file_write(path, "int a ; int b ;");
+  const ReflectTokenBuffer* after = reflect_token_cache_get(cache, path);
+  if (!after || after == before || after->count != 6) {
+    printf("    Assertion #2: FAILED - the modified file was not lexed again\n");
+    return;
+  }
+
+  if (before->count != 3 || strcmp(before->tokens[1].as.identifier, "a") != 0) {
+    printf("    Assertion #3: FAILED - the original buffer was invalidated\n");
+    return;
+  }
+
+  path_make(path, sizeof(path), "missing.h");
+  if (reflect_token_cache_get(cache, path) != NULL) {
+    printf("    Assertion #4: FAILED - got a buffer for a missing file\n");
+    return;
+  }
+
+  if (!silent) {
+    printf("    All Test Assertions Passed!\n");
+  }
+}
+
+int main(int argc, const char* argv[]) {
+  if (argc > 1 && strcmp(argv[1], "--verbose")) {
+    silent = false;
+  }
+
+  if (!mkdtemp(directory)) {
+    perror("mkdtemp");
+    return 1;
+  }
+
+  printf("Token Cache Tests:\n");
+
+  ReflectTokenCache cache;
+  if (!reflect_token_cache_init(&cache)) {
+    printf("  Could not initialize the token cache\n");
+    return 1;
+  }
+  cache_sharing_tests(&cache);
+  cache_invalidation_tests(&cache);
+  reflect_token_cache_free(&cache);
+
+  char path[256];
+  path_make(path, sizeof(path), "common.h");
+  remove(path);
+  path_make(path, sizeof(path), "changing.h");
+  remove(path);
+  remove(directory);
+
+  return 0;
+}
@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define REFLECT_IMPLEMENTATION
+#define REFLECT_POSIX
+#include "../reflect.h"
+
+static bool silent = true;
+
+static char directory[] = "/tmp/reflect_index_XXXXXX";
+
+typedef struct IndexTestPosting {
+  const char* file;
+  uint32_t    line;
+  uint32_t    column;
+} IndexTestPosting;
+
+static void file_write(const char* name, const char* content) {
+  char path[256];
+  snprintf(path, sizeof(path), "%s/%s", directory, name);
+  FILE* file = fopen(path, "w");
+  assert(file && "could not create test file");
+  fputs(content, file);
+  fclose(file);
+}
+
+static bool files_update(ReflectIndex* index, const char* names[]) {
+  char path[256];
+  for (; *names; ++names) {
+    snprintf(path, sizeof(path), "%s/%s", directory, *names);
+    if (!reflect_index_file_update(index, path)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Checks the postings of `symbol` in the index written to `path`, `expected` ends with a NULL file.
+static bool index_query_check(const char* path, const char* symbol, const IndexTestPosting expected[], int* assertion) {
+  ReflectIndexView view;
+  if (!reflect_index_view_open(&view, path)) {
+    printf("    Assertion #%d: FAILED - could not open the index\n", *assertion);
+    return false;
+  }
+
+  ReflectIndexIterator iterator;
+  ReflectIndexPosting  posting;
+  uint32_t             count  = reflect_index_view_find(&view, symbol, &iterator);
+  bool                 passed = true;
+  for (; expected->file; ++expected, ++*assertion) {
+    if (!reflect_index_iterator_next(&iterator, &posting)) {
+      printf("    Assertion #%d: FAILED - \"%s\" has only %u postings\n", *assertion, symbol, count);
+      passed = false;
+      break;
+    }
+
+    const char* file = strrchr(reflect_index_view_file_path_get(&view, posting.file), '/') + 1;
+    if (strcmp(file, expected->file) != 0 || posting.location.line != expected->line || posting.location.column != expected->column) {
+      printf(
+        "    Assertion #%d: FAILED - \"%s\" expected at %s:%u:%u, got %s:%u:%u\n",
+        *assertion,
+        symbol,
+        expected->file,
+        expected->line,
+        expected->column,
+        file,
+        posting.location.line,
+        posting.location.column
+      );
+      passed = false;
+      break;
+    }
+  }
+
+  if (passed && reflect_index_iterator_next(&iterator, &posting)) {
+    printf("    Assertion #%d: FAILED - \"%s\" has more postings than expected\n", *assertion, symbol);
+    passed = false;
+  }
+  ++*assertion;
+
+  reflect_index_view_close(&view);
+  return passed;
+}
+
+void index_query_tests(const char* path) {
+  printf("  Running Test: Symbol Postings\n");
+
+  const char* names[] = { "vector.h", "vector.c", "main.c", NULL };
+  file_write("vector.h", "struct Vector {\n  int x;\n  int y;\n};\n");
+  file_write("vector.c", "int vector_dot(struct Vector* a, struct Vector* b) {\n  return a->x * b->x;\n}\n");
+  file_write("main.c", "int main() {\n  struct Vector v;\n  return vector_dot(&v, &v);\n}\n");
+
+  ReflectIndex index;
+  reflect_index_init(&index);
+  if (!files_update(&index, names) || !reflect_index_write(&index, path)) {
+    printf("    Assertion #1: FAILED - could not build the index\n");
+    reflect_index_free(&index);
+    return;
+  }
+  reflect_index_free(&index);
+
+  int assertion = 1;
+  bool passed = index_query_check(path, "Vector", (IndexTestPosting[]) {
+    { "vector.h", 1, 8 },
+    { "vector.c", 1, 23 },
+    { "vector.c", 1, 41 },
+    { "main.c",   2, 10 },
+    { NULL, 0, 0 },
+  }, &assertion);
+
+  passed = passed && index_query_check(path, "x", (IndexTestPosting[]) {
+    { "vector.h", 2, 7 },
+    { "vector.c", 2, 13 },
+    { "vector.c", 2, 20 },
+    { NULL, 0, 0 },
+  }, &assertion);
+
+  passed = passed && index_query_check(path, "missing", (IndexTestPosting[]) {
+    { NULL, 0, 0 },
+  }, &assertion);
+
+  if (passed && !silent) {
+    printf("    All Test Assertions Passed!\n");
+  }
+}
+
+void index_incremental_tests(const char* path) {
+  printf("  Running Test: Incremental Update\n");
+
+  ReflectIndex index;
+  reflect_index_init(&index);
+  if (!reflect_index_read(&index, path)) {
+    printf("    Assertion #1: FAILED - could not read the index back\n");
+    reflect_index_free(&index);
+    return;
+  }
+
+  const char* names[] = { "vector.h", "vector.c", "extra.c", NULL };
+  file_write("vector.c", "int vector_x(struct Vector* a) {\n  return a->x;\n}\n");
+  file_write("extra.c", "struct Vector extra;\n");
+
+  char removed[256];
+  snprintf(removed, sizeof(removed), "%s/main.c", directory);
+  reflect_index_file_remove(&index, removed);
+  remove(removed);
+
+  if (!files_update(&index, names) || !reflect_index_write(&index, path)) {
+    printf("    Assertion #2: FAILED - could not update the index\n");
+    reflect_index_free(&index);
+    return;
+  }
+  reflect_index_free(&index);
+
+  int assertion = 3;
+  bool passed = index_query_check(path, "Vector", (IndexTestPosting[]) {
+    { "vector.h", 1, 8 },
+    { "vector.c", 1, 21 },
+    { "extra.c",  1, 8 },
+    { NULL, 0, 0 },
+  }, &assertion);
+
+  passed = passed && index_query_check(path, "vector_dot", (IndexTestPosting[]) {
+    { NULL, 0, 0 },
+  }, &assertion);
+
+  passed = passed && index_query_check(path, "y", (IndexTestPosting[]) {
+    { "vector.h", 3, 7 },
+    { NULL, 0, 0 },
+  }, &assertion);
+
+  if (passed && !silent) {
+    printf("    All Test Assertions Passed!\n");
+  }
+}
+
+// Writes `size` bytes of `data` to `path`.
+static void index_bytes_write(const char* path, const uint8_t* data, size_t size) {
+  FILE* file = fopen(path, "wb");
+  assert(file && "could not create test file");
+  fwrite(data, 1, size, file);
+  fclose(file);
+}
+
+void index_corruption_tests(const char* path) {
+  printf("  Running Test: Corrupted Index Files\n");
+
+  static uint8_t original[4096];
+  static uint8_t data[4096];
+  FILE*          file = fopen(path, "rb");
+  assert(file && "could not open the index");
+  size_t size = fread(original, 1, sizeof(original), file);
+  fclose(file);
+
+  char corrupted[256];
+  snprintf(corrupted, sizeof(corrupted), "%s/corrupted.rflidx", directory);
+
+  ReflectIndexHeader header;
+  memcpy(&header, original, sizeof(header));
+
+  ReflectIndexHeader headers[6];
+  for (size_t i = 0; i < sizeof(headers) / sizeof(headers[0]); ++i) {
+    headers[i] = header;
+  }
+  headers[0].slot_count      = 0;
+  headers[1].file_count      = UINT32_MAX;
+  headers[2].symbols_offset  = header.files_offset + 4;
+  headers[3].strings_offset  = header.postings_offset + 8;
+  headers[4].postings_offset = UINT64_MAX;
+  headers[5].size            = size + 1;
+
+  int assertion = 1;
+  for (size_t i = 0; i < sizeof(headers) / sizeof(headers[0]); ++i, ++assertion) {
+    memcpy(data, original, size);
+    memcpy(data, &headers[i], sizeof(header));
+    index_bytes_write(corrupted, data, size);
+
+    ReflectIndexView view;
+    if (reflect_index_view_open(&view, corrupted)) {
+      printf("    Assertion #%d: FAILED - opened an index with corrupted header %zu\n", assertion, i);
+      reflect_index_view_close(&view);
+      return;
+    }
+  }
+
+  // A name pointing past the strings section.
+  memcpy(data, original, size);
+  ReflectIndexSymbolRecord* symbols = (ReflectIndexSymbolRecord*)(data + header.symbols_offset);
+  symbols[0].name_offset = header.postings_offset - header.strings_offset;
+  index_bytes_write(corrupted, data, size);
+  ReflectIndexView view;
+  if (reflect_index_view_open(&view, corrupted)) {
+    printf("    Assertion #%d: FAILED - opened an index with a name outside of the strings\n", assertion);
+    reflect_index_view_close(&view);
+    return;
+  }
+  assertion++;
+
+  // A varint running past the end of the file, the last byte belongs to the last posting.
+  memcpy(data, original, size);
+  data[size - 1] |= 0x80;
+  index_bytes_write(corrupted, data, size);
+  ReflectIndex index;
+  reflect_index_init(&index);
+  bool read = reflect_index_read(&index, corrupted);
+  reflect_index_free(&index);
+  if (read) {
+    printf("    Assertion #%d: FAILED - read an index with truncated postings\n", assertion);
+    return;
+  }
+
+  if (!silent) {
+    printf("    All Test Assertions Passed!\n");
+  }
+}
+
+int main(int argc, const char* argv[]) {
+  if (argc > 1 && strcmp(argv[1], "--verbose")) {
+    silent = false;
+  }
+
+  if (!mkdtemp(directory)) {
+    perror("mkdtemp");
+    return 1;
+  }
+
+  char path[256];
+  snprintf(path, sizeof(path), "%s/index.rflidx", directory);
+
+  printf("Index Tests:\n");
+  index_query_tests(path);
+  index_incremental_tests(path);
+  index_corruption_tests(path);
+
+  const char* names[] = { "vector.h", "vector.c", "main.c", "extra.c", "index.rflidx", "corrupted.rflidx" };
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+    snprintf(path, sizeof(path), "%s/%s", directory, names[i]);
+    remove(path);
+  }
+  remove(directory);
+
+  return 0;
+}
@@ -10,13 +10,14 @@
 
 static bool silent = true;
 
-void lexer_test(const char* test_name, const char* source, ReflectToken test_cases[]) {
+void lexer_mode_test(const char* test_name, const char* source, ReflectLexerMode mode, ReflectToken test_cases[]) {
   printf("  Running Test: %s\n", test_name);
 
   ReflectLexer lexer;
   ReflectToken token;
 
   reflect_lexer_init(&lexer, source);
+  reflect_lexer_mode_set(&lexer, mode);
   int test_case_number = 1;
   while (test_cases->type != REFLECT_TOKEN_EOF) {
     if (!reflect_lexer_token_next(&lexer, &token)) {
@@ -35,6 +36,22 @@ void lexer_test(const char* test_name, const char* source, ReflectToken test_cas
       return;
     }
 
+    // Test cases without a line do not check the location.
+    if (
+      test_cases->location.line != 0 &&
+      (test_cases->location.line != token.location.line || test_cases->location.column != token.location.column)
+    ) {
+      printf(
+        "    Assertion #%d: FAILED - location mismatch - expected: %u:%u, got %u:%u\n",
+        test_case_number,
+        test_cases->location.line,
+        test_cases->location.column,
+        token.location.line,
+        token.location.column
+      );
+      return;
+    }
+
     bool passed = false;
     switch (token.type) {
       case REFLECT_TOKEN_EOF:
@@ -69,14 +86,25 @@ void lexer_test(const char* test_name, const char* source, ReflectToken test_cas
     test_cases++;
   }
 
+  if (!reflect_lexer_token_next(&lexer, &token) || token.type != REFLECT_TOKEN_EOF) {
+    printf("    Assertion #%d: FAILED - expected '<EOF>'\n", test_case_number);
+    return;
+  }
+
   if (!silent) {
     printf("    All Test Assertions Passed!\n");
   }
 }
 
+void lexer_test(const char* test_name, const char* source, ReflectToken test_cases[]) {
+  lexer_mode_test(test_name, source, REFLECT_LEXER_MODE_FULL, test_cases);
+}
+
 void lexer_integer_tests();
 void lexer_punctuator_tests();
 void lexer_identifier_tests();
+void lexer_engine_tests();
+void lexer_declarations_tests();
 
 int main(int argc, const char* argv[]) {
   if (argc > 1 && strcmp(argv[1], "--verbose")) {
@@ -87,6 +115,8 @@ int main(int argc, const char* argv[]) {
   lexer_integer_tests();
   lexer_punctuator_tests();
   lexer_identifier_tests();
+  lexer_engine_tests();
+  lexer_declarations_tests();
 
   return 0;
 }
@@ -243,4 +273,310 @@ void lexer_punctuator_tests() {
       { 0 }
     }
   );
-}
\ No newline at end of file
+}
+void lexer_engine_test(const char* test_name, const char* source) {
+  printf("  Running Test: %s\n", test_name);
+
+  ReflectLexer switch_lexer;
+  ReflectLexer dfa_lexer;
+  ReflectToken switch_token;
+  ReflectToken dfa_token;
+  memset(&switch_token, 0, sizeof(switch_token));
+  memset(&dfa_token, 0, sizeof(dfa_token));
+
+  reflect_lexer_init(&switch_lexer, source);
+  reflect_lexer_init(&dfa_lexer, source);
+  int test_case_number = 1;
+  while (true) {
+    bool switch_result = reflect_lexer_token_next_switch(&switch_lexer, &switch_token);
+    bool dfa_result    = reflect_lexer_token_next_dfa(&dfa_lexer, &dfa_token);
+
+    if (switch_result != dfa_result || switch_lexer.stream != dfa_lexer.stream) {
+      printf("    Assertion #%d: FAILED - engines disagree on the token length\n", test_case_number);
+      return;
+    }
+
+    if (!switch_result) {
+      if (strcmp(reflect_lexer_error_string_get(&switch_lexer), reflect_lexer_error_string_get(&dfa_lexer)) != 0) {
+        printf("    Assertion #%d: FAILED - engines disagree on the error\n", test_case_number);
+        return;
+      }
+    } else if (memcmp(&switch_token, &dfa_token, sizeof(ReflectToken)) != 0) {
+      printf(
+        "    Assertion #%d: FAILED - token mismatch - switch: '%s' %u:%u, dfa: '%s' %u:%u\n",
+        test_case_number,
+        reflect_token_type_to_string(switch_token.type),
+        switch_token.location.line,
+        switch_token.location.column,
+        reflect_token_type_to_string(dfa_token.type),
+        dfa_token.location.line,
+        dfa_token.location.column
+      );
+      return;
+    }
+
+    if (switch_result && switch_token.type == REFLECT_TOKEN_EOF) {
+      break;
+    }
+    test_case_number++;
+  }
+
+  if (!silent) {
+    printf("    All Test Assertions Passed!\n");
+  }
+}
+
+void lexer_engine_tests() {
+  printf(" Engine Tests:\n");
+  lexer_engine_test(
+    "Punctuator Streams Match",
+    "[](){}.,&*+-~!/%<>^|?:;=# -> ++ -- << >> <= >= == != && || *= /= %= += -= &= ^= |= ## <<= >>= ..."
+    "..-->>>=<<<=&&=||=..x.....+++---->"
+  );
+
+  lexer_engine_test(
+    "Mixed Source Streams Match",
+    "struct Vector {\n  int x;\n  int y;\n};\n\n"
+    "static int vector_dot(struct Vector* a, struct Vector* b) {\n"
+    "  return a->x * b->x + a->y * b->y;\n"
+    "}\n"
+    "int values[0x10] = { 0, 017, 0xFFul, 42u, 7ll };\n"
+  );
+
+  lexer_engine_test(
+    "Invalid Character Streams Match",
+    "a $ b @ c\t\"d\" 'e' \\"
+  );
+}
+
+void lexer_declarations_tests() {
+  printf(" Declarations Mode Tests:\n");
+  lexer_mode_test(
+    "Function Bodies Are Skipped",
+    "struct Vector { int x; };\n"
+    "int vector_x(struct Vector* v) {\n"
+    "  if (v) { return v->x; }\n"
+    "  return 0;\n"
+    "}\n"
+    "int y;",
+    REFLECT_LEXER_MODE_DECLARATIONS,
+    (ReflectToken[]) {
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "struct" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "Vector" },
+      { .type = REFLECT_TOKEN_LBRACE },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "int" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "x" },
+      { .type = REFLECT_TOKEN_SEMICOLON },
+      { .type = REFLECT_TOKEN_RBRACE },
+      { .type = REFLECT_TOKEN_SEMICOLON },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "int" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "vector_x" },
+      { .type = REFLECT_TOKEN_LPAREN },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "struct" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "Vector" },
+      { .type = REFLECT_TOKEN_STAR },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "v" },
+      { .type = REFLECT_TOKEN_RPAREN },
+      { .type = REFLECT_TOKEN_LBRACE, .location = { 2, 32 } },
+      { .type = REFLECT_TOKEN_RBRACE, .location = { 5, 1 } },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "int", .location = { 6, 1 } },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "y", .location = { 6, 5 } },
+      { .type = REFLECT_TOKEN_SEMICOLON },
+      { 0 }
+    }
+  );
+
+  lexer_mode_test(
+    "Braces In Strings And Comments",
+    "void f() {\n"
+    "  puts(\"} \\\" }\"); char c = '}'; char d = '\\'';\n"
+    "  // } unbalanced\n"
+    "  /* } { }\n"
+    "     } */ if (x) { { } }\n"
+    "  long_enough_to_cross_several_sixteen_byte_chunks_of_the_scanner(a / b);\n"
+    "} int z;",
+    REFLECT_LEXER_MODE_DECLARATIONS,
+    (ReflectToken[]) {
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "void" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "f" },
+      { .type = REFLECT_TOKEN_LPAREN },
+      { .type = REFLECT_TOKEN_RPAREN },
+      { .type = REFLECT_TOKEN_LBRACE },
+      { .type = REFLECT_TOKEN_RBRACE, .location = { 7, 1 } },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "int", .location = { 7, 3 } },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "z" },
+      { .type = REFLECT_TOKEN_SEMICOLON },
+      { 0 }
+    }
+  );
+
+  lexer_mode_test(
+    "Nested And Initializer Braces Are Kept",
+    "struct A { struct B { int x; } b; } a = { { 1 } };",
+    REFLECT_LEXER_MODE_DECLARATIONS,
+    (ReflectToken[]) {
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "struct" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "A" },
+      { .type = REFLECT_TOKEN_LBRACE },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "struct" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "B" },
+      { .type = REFLECT_TOKEN_LBRACE },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "int" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "x" },
+      { .type = REFLECT_TOKEN_SEMICOLON },
+      { .type = REFLECT_TOKEN_RBRACE },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "b" },
+      { .type = REFLECT_TOKEN_SEMICOLON },
+      { .type = REFLECT_TOKEN_RBRACE },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "a" },
+      { .type = REFLECT_TOKEN_ASSIGN },
+      { .type = REFLECT_TOKEN_LBRACE },
+      { .type = REFLECT_TOKEN_LBRACE },
+      { .type = REFLECT_TOKEN_INTEGER, .as.integer = 1 },
+      { .type = REFLECT_TOKEN_RBRACE },
+      { .type = REFLECT_TOKEN_RBRACE },
+      { .type = REFLECT_TOKEN_SEMICOLON },
+      { 0 }
+    }
+  );
+
+  lexer_mode_test(
+    "Attributed And Anonymous Type Bodies Are Kept",
+    "typedef struct __attribute__((packed)) { int x; int y; } Foo;\n"
+    "struct S s = (struct S){ 1 };\n"
+    "struct S* make(void) { return 0; }",
+    REFLECT_LEXER_MODE_DECLARATIONS,
+    (ReflectToken[]) {
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "typedef" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "struct" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "__attribute__" },
+      { .type = REFLECT_TOKEN_LPAREN },
+      { .type = REFLECT_TOKEN_LPAREN },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "packed" },
+      { .type = REFLECT_TOKEN_RPAREN },
+      { .type = REFLECT_TOKEN_RPAREN },
+      { .type = REFLECT_TOKEN_LBRACE },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "int" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "x" },
+      { .type = REFLECT_TOKEN_SEMICOLON },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "int" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "y" },
+      { .type = REFLECT_TOKEN_SEMICOLON },
+      { .type = REFLECT_TOKEN_RBRACE },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "Foo" },
+      { .type = REFLECT_TOKEN_SEMICOLON },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "struct" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "S" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "s" },
+      { .type = REFLECT_TOKEN_ASSIGN },
+      { .type = REFLECT_TOKEN_LPAREN },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "struct" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "S" },
+      { .type = REFLECT_TOKEN_RPAREN },
+      { .type = REFLECT_TOKEN_LBRACE },
+      { .type = REFLECT_TOKEN_INTEGER, .as.integer = 1 },
+      { .type = REFLECT_TOKEN_RBRACE },
+      { .type = REFLECT_TOKEN_SEMICOLON },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "struct" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "S" },
+      { .type = REFLECT_TOKEN_STAR },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "make" },
+      { .type = REFLECT_TOKEN_LPAREN },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "void" },
+      { .type = REFLECT_TOKEN_RPAREN },
+      { .type = REFLECT_TOKEN_LBRACE },
+      { .type = REFLECT_TOKEN_RBRACE, .location = { 3, 34 } },
+      { 0 }
+    }
+  );
+
+  lexer_mode_test(
+    "Unterminated Literals Keep Line Numbers",
+    "void f() {\n"
+    "  #error don't\n"
+    "  x;\n"
+    "}\n"
+    "int after;",
+    REFLECT_LEXER_MODE_DECLARATIONS,
+    (ReflectToken[]) {
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "void" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "f" },
+      { .type = REFLECT_TOKEN_LPAREN },
+      { .type = REFLECT_TOKEN_RPAREN },
+      { .type = REFLECT_TOKEN_LBRACE },
+      { .type = REFLECT_TOKEN_RBRACE, .location = { 4, 1 } },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "int", .location = { 5, 1 } },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "after", .location = { 5, 5 } },
+      { .type = REFLECT_TOKEN_SEMICOLON },
+      { 0 }
+    }
+  );
+
+  lexer_mode_test(
+    "Unbalanced Macro Braces Are Ignored",
+    "#define BEGIN(x) {\n"
+    "struct A { int a; };\n"
+    "#define END }\n"
+    "int f(void) { return 0; }\n"
+    "#if X\n"
+    "struct B { int b; };",
+    REFLECT_LEXER_MODE_DECLARATIONS,
+    (ReflectToken[]) {
+      { .type = REFLECT_TOKEN_HASH },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "define" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "BEGIN" },
+      { .type = REFLECT_TOKEN_LPAREN },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "x" },
+      { .type = REFLECT_TOKEN_RPAREN },
+      { .type = REFLECT_TOKEN_LBRACE, .location = { 1, 18 } },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "struct", .location = { 2, 1 } },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "A" },
+      { .type = REFLECT_TOKEN_LBRACE },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "int" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "a" },
+      { .type = REFLECT_TOKEN_SEMICOLON },
+      { .type = REFLECT_TOKEN_RBRACE },
+      { .type = REFLECT_TOKEN_SEMICOLON },
+      { .type = REFLECT_TOKEN_HASH, .location = { 3, 1 } },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "define" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "END" },
+      { .type = REFLECT_TOKEN_RBRACE },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "int", .location = { 4, 1 } },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "f" },
+      { .type = REFLECT_TOKEN_LPAREN },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "void" },
+      { .type = REFLECT_TOKEN_RPAREN },
+      { .type = REFLECT_TOKEN_LBRACE },
+      { .type = REFLECT_TOKEN_RBRACE, .location = { 4, 25 } },
+      { .type = REFLECT_TOKEN_HASH, .location = { 5, 1 } },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "if" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "X" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "struct", .location = { 6, 1 } },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "B" },
+      { .type = REFLECT_TOKEN_LBRACE },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "int" },
+      { .type = REFLECT_TOKEN_IDENTIFIER, .as.identifier = "b" },
+      { .type = REFLECT_TOKEN_SEMICOLON },
+      { .type = REFLECT_TOKEN_RBRACE },
+      { .type = REFLECT_TOKEN_SEMICOLON },
+      { 0 }
+    }
+  );
+
+  printf("  Running Test: Unterminated Function Body\n");
+  ReflectLexer lexer;
+  ReflectToken token;
+  reflect_lexer_init(&lexer, "int f() { if (x) {\n");
+  reflect_lexer_mode_set(&lexer, REFLECT_LEXER_MODE_DECLARATIONS);
+  while (reflect_lexer_token_next(&lexer, &token) && token.type != REFLECT_TOKEN_LBRACE) {
+  }
+  if (token.type != REFLECT_TOKEN_LBRACE || reflect_lexer_error_code_get(&lexer) != REFLECT_ERROR_NONE) {
+    printf("    Assertion #1: FAILED - expected the '{' of the body without an error\n");
+  } else if (reflect_lexer_token_next(&lexer, &token) || reflect_lexer_error_code_get(&lexer) != REFLECT_ERROR_UNTERMINATED_BODY) {
+    printf("    Assertion #2: FAILED - expected an unterminated body error\n");
+  } else if (!reflect_lexer_token_next(&lexer, &token) || token.type != REFLECT_TOKEN_EOF) {
+    printf("    Assertion #3: FAILED - expected '<EOF>' after the error\n");
+  } else if (!silent) {
+    printf("    All Test Assertions Passed!\n");
+  }
+}
@@ -0,0 +1,174 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define REFLECT_IMPLEMENTATION
+#define REFLECT_POSIX
+#define REFLECT_IO_URING
+#include "../reflect.h"
+
+#define FILE_COUNT 40
+
+static bool silent = true;
+
+static char directory[] = "/tmp/reflect_pipeline_XXXXXX";
+
+typedef struct PipelineTestResult {
+  const char* const* paths;
+  size_t             sizes[FILE_COUNT + 1];
+  size_t             token_counts[FILE_COUNT + 1];
+  int                errors[FILE_COUNT + 1];
+  int                calls[FILE_COUNT + 1];
+  pthread_mutex_t    mutex;
+} PipelineTestResult;
+
+static size_t source_token_count(const char* source) {
+  ReflectLexer lexer;
+  ReflectToken token;
+  size_t       count = 0;
+  reflect_lexer_init(&lexer, source);
+  while (true) {
+    if (!reflect_lexer_token_next(&lexer, &token)) {
+      continue;
+    }
+    if (token.type == REFLECT_TOKEN_EOF) {
+      break;
+    }
+    count++;
+  }
+  return count;
+}
+
+static void pipeline_test_callback(void* user_data, const char* path, const char* source, size_t size, int error) {
+  PipelineTestResult* result = user_data;
+  size_t              file   = 0;
+  while (result->paths[file] != path) {
+    file++;
+  }
+
+  size_t token_count = source ? source_token_count(source) : 0;
+  pthread_mutex_lock(&result->mutex);
+  result->sizes[file]        = size;
+  result->token_counts[file] = token_count;
+  result->errors[file]       = error;
+  result->calls[file]++;
+  pthread_mutex_unlock(&result->mutex);
+}
+
+// Every file repeats "field_<file> = <file>;" so it lexes to 4 tokens per repetition.
+static size_t file_repetitions(size_t file) {
+  return file == 0 ? 0 : file * file * 40;
+}
+
+void pipeline_test(const char* test_name, ReflectPipelineBackend backend, uint32_t buffer_count, size_t buffer_size_max, const char* const* paths) {
+  printf("  Running Test: %s\n", test_name);
+
+  PipelineTestResult result;
+  memset(&result, 0, sizeof(result));
+  result.paths = paths;
+  pthread_mutex_init(&result.mutex, NULL);
+
+  ReflectPipelineOptions options;
+  reflect_pipeline_options_default(&options);
+  options.backend         = backend;
+  options.buffer_count    = buffer_count;
+  options.buffer_size     = 4096;
+  options.buffer_size_max = buffer_size_max;
+  options.worker_count    = 2;
+
+  ReflectPipelineBackend used;
+  bool                   ran = reflect_pipeline_run(&options, paths, FILE_COUNT + 1, pipeline_test_callback, &result, &used);
+  if (!ran && backend == REFLECT_PIPELINE_BACKEND_IO_URING && errno == ENOSYS) {
+    // Kernels without io_uring, or containers filtering its syscalls.
+    printf("    Skipped: io_uring is not available\n");
+    pthread_mutex_destroy(&result.mutex);
+    return;
+  }
+  if (!ran || used != backend) {
+    printf("    Assertion #1: FAILED - the pipeline did not run with the requested backend\n");
+    pthread_mutex_destroy(&result.mutex);
+    return;
+  }
+
+  int  assertion = 2;
+  bool passed    = true;
+  for (size_t file = 0; passed && file < FILE_COUNT; ++file, ++assertion) {
+    // Files that do not fit the largest buffer fail, the others are read whole.
+    struct stat info;
+    stat(paths[file], &info);
+    int    expected_error  = buffer_size_max && (size_t)info.st_size >= buffer_size_max ? EFBIG : 0;
+    size_t expected_tokens = expected_error ? 0 : file_repetitions(file) * 4;
+    if (result.calls[file] != 1 || result.errors[file] != expected_error || result.token_counts[file] != expected_tokens) {
+      printf(
+        "    Assertion #%d: FAILED - file %zu: %d calls, error %d, %zu tokens\n",
+        assertion,
+        file,
+        result.calls[file],
+        result.errors[file],
+        result.token_counts[file]
+      );
+      passed = false;
+    }
+  }
+
+  if (passed && (result.calls[FILE_COUNT] != 1 || result.errors[FILE_COUNT] != ENOENT)) {
+    printf("    Assertion #%d: FAILED - the missing file was not reported\n", assertion);
+    passed = false;
+  }
+
+  if (passed && !silent) {
+    printf("    All Test Assertions Passed!\n");
+  }
+  pthread_mutex_destroy(&result.mutex);
+}
+
+int main(int argc, const char* argv[]) {
+  if (argc > 1 && strcmp(argv[1], "--verbose")) {
+    silent = false;
+  }
+
+  if (!mkdtemp(directory)) {
+    perror("mkdtemp");
+    return 1;
+  }
+
+  static char  names[FILE_COUNT + 1][256];
+  const char*  paths[FILE_COUNT + 1];
+  for (size_t file = 0; file <= FILE_COUNT; ++file) {
+    snprintf(names[file], sizeof(names[file]), "%s/file_%zu.c", directory, file);
+    paths[file] = names[file];
+    if (file == FILE_COUNT) {
+      break;
+    }
+
+    FILE* stream = fopen(names[file], "w");
+    assert(stream && "could not create test file");
+    for (size_t i = 0; i < file_repetitions(file); ++i) {
+      fprintf(stream, "field_%zu = %zu;\n", file, file);
+    }
+    fclose(stream);
+  }
+
+  printf("Pipeline Tests:\n");
+  // A small pool with a small initial size, so buffers are recycled and grown.
+  pipeline_test("Thread Backend Reads Every File", REFLECT_PIPELINE_BACKEND_THREADS, 3, 0, paths);
+  pipeline_test("io_uring Backend Reads Every File", REFLECT_PIPELINE_BACKEND_IO_URING, 3, 0, paths);
+
+  // Only the first few files fit in 64 KB, the rest must fail with EFBIG instead of growing the buffers.
+  pipeline_test("Thread Backend Rejects Files Over The Buffer Limit", REFLECT_PIPELINE_BACKEND_THREADS, 3, 64 * 1024, paths);
+  pipeline_test("io_uring Backend Rejects Files Over The Buffer Limit", REFLECT_PIPELINE_BACKEND_IO_URING, 3, 64 * 1024, paths);
+
+  // Every file is opened right away, so the last reads to complete are the resubmitted ones when
+  // REFLECT__PIPELINE_URING_READ_MAX forces short reads.
+  pipeline_test("io_uring Backend Finishes Resubmitted Reads", REFLECT_PIPELINE_BACKEND_IO_URING, FILE_COUNT + 1, 0, paths);
+
+  for (size_t file = 0; file < FILE_COUNT; ++file) {
+    remove(names[file]);
+  }
+  remove(directory);
+
+  return 0;
+}
@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define REFLECT_IMPLEMENTATION
+#include "../reflect.h"
+
+static bool silent = true;
+
+static bool token_equals(const ReflectToken* expected, const ReflectToken* actual) {
+  if (
+    expected->type            != actual->type            ||
+    expected->modifier        != actual->modifier        ||
+    expected->location.line   != actual->location.line   ||
+    expected->location.column != actual->location.column
+  ) {
+    return false;
+  }
+
+  switch (expected->type) {
+    case REFLECT_TOKEN_IDENTIFIER:
+      return strcmp(expected->as.identifier, actual->as.identifier) == 0;
+    case REFLECT_TOKEN_INTEGER:
+      return expected->as.integer == actual->as.integer &&
+             strncmp(expected->suffix_string, actual->suffix_string, REFLECT_MAX_SUFFIX_LENGTH) == 0;
+    default:
+      return true;
+  }
+}
+
+void store_round_trip_test(const char* test_name, const char* source) {
+  printf("  Running Test: %s\n", test_name);
+
+  ReflectTokenBuffer buffer;
+  ReflectTokenStore  store;
+  if (!reflect_token_buffer_lex(&buffer, source)) {
+    printf("    Assertion #1: FAILED - could not lex the source\n");
+    return;
+  }
+
+  reflect_token_store_init(&store);
+  for (size_t i = 0; i < buffer.count; ++i) {
+    if (!reflect_token_store_push(&store, &buffer.tokens[i])) {
+      printf("    Assertion #1: FAILED - could not push token %zu\n", i);
+      goto cleanup;
+    }
+  }
+
+  if (store.count != buffer.count) {
+    printf("    Assertion #1: FAILED - expected %zu tokens, got %zu\n", buffer.count, store.count);
+    goto cleanup;
+  }
+
+  ReflectToken            token;
+  ReflectTokenStoreCursor cursor;
+  reflect_token_store_cursor_init(&cursor, &store, 0);
+  for (size_t i = 0; i < buffer.count; ++i) {
+    if (!reflect_token_store_cursor_next(&cursor, &token) || !token_equals(&buffer.tokens[i], &token)) {
+      printf("    Assertion #2: FAILED - sequential decode differs at token %zu\n", i);
+      goto cleanup;
+    }
+  }
+  if (reflect_token_store_cursor_next(&cursor, &token)) {
+    printf("    Assertion #3: FAILED - cursor went past the end\n");
+    goto cleanup;
+  }
+
+  // Walk backwards so every lookup seeks from its block.
+  for (size_t i = buffer.count; i-- > 0;) {
+    if (!reflect_token_store_get(&store, i, &token) || !token_equals(&buffer.tokens[i], &token)) {
+      printf("    Assertion #4: FAILED - random access differs at token %zu\n", i);
+      goto cleanup;
+    }
+  }
+  if (reflect_token_store_get(&store, buffer.count, &token)) {
+    printf("    Assertion #5: FAILED - got a token past the end\n");
+    goto cleanup;
+  }
+
+  // An odd batch size so batches straddle the store's blocks.
+  ReflectTokenStoreEntry entries[37];
+  size_t                 entry_count = 0;
+  reflect_token_store_cursor_init(&cursor, &store, 0);
+  for (size_t i = 0; i < buffer.count; ++i) {
+    if (i % 37 == 0) {
+      entry_count = reflect_token_store_cursor_entries_read(&cursor, entries, 37);
+    }
+
+    const ReflectToken*           expected = &buffer.tokens[i];
+    const ReflectTokenStoreEntry* entry    = &entries[i % 37];
+    bool                          passed   = i % 37                 <  entry_count               &&
+                                             entry->type            == expected->type            &&
+                                             entry->modifier        == expected->modifier        &&
+                                             entry->location.line   == expected->location.line   &&
+                                             entry->location.column == expected->location.column;
+    if (passed && entry->type == REFLECT_TOKEN_IDENTIFIER) {
+      passed = strcmp(reflect_string_table_get(&store.strings, entry->string), expected->as.identifier) == 0;
+    } else if (passed && entry->type == REFLECT_TOKEN_INTEGER) {
+      passed = entry->integer == expected->as.integer &&
+               strcmp(reflect_string_table_get(&store.strings, entry->string), expected->suffix_string) == 0;
+    }
+    if (!passed) {
+      printf("    Assertion #6: FAILED - column decode differs at token %zu\n", i);
+      goto cleanup;
+    }
+  }
+  if (reflect_token_store_cursor_entries_read(&cursor, entries, 37) != 0) {
+    printf("    Assertion #7: FAILED - column cursor went past the end\n");
+    goto cleanup;
+  }
+
+  if (!silent) {
+    printf("    All Test Assertions Passed!\n");
+  }
+
+cleanup:
+  reflect_token_store_free(&store);
+  reflect_token_buffer_free(&buffer);
+}
+
+void store_string_table_tests() {
+  printf("  Running Test: String Interning\n");
+
+  ReflectStringTable table;
+  reflect_string_table_init(&table);
+
+  char     name[32];
+  uint32_t id;
+  for (uint32_t i = 0; i < 2000; ++i) {
+    snprintf(name, sizeof(name), "name_%u", i % 1000);
+    if (!reflect_string_table_intern(&table, name, &id) || id != i % 1000) {
+      printf("    Assertion #1: FAILED - \"%s\" was not interned once\n", name);
+      goto cleanup;
+    }
+  }
+
+  if (table.count != 1000 || strcmp(reflect_string_table_get(&table, 42), "name_42") != 0) {
+    printf("    Assertion #2: FAILED - the table does not hold the interned strings\n");
+    goto cleanup;
+  }
+
+  if (!reflect_string_table_find(&table, "name_999", &id) || id != 999 || reflect_string_table_find(&table, "name_1000", &id)) {
+    printf("    Assertion #3: FAILED - lookup without interning is wrong\n");
+    goto cleanup;
+  }
+
+  if (!silent) {
+    printf("    All Test Assertions Passed!\n");
+  }
+
+cleanup:
+  reflect_string_table_free(&table);
+}
+
+int main(int argc, const char* argv[]) {
+  if (argc > 1 && strcmp(argv[1], "--verbose")) {
+    silent = false;
+  }
+
+  printf("Token Store Tests:\n");
+  store_string_table_tests();
+
+  store_round_trip_test("Empty Source Round Trip", "");
+
+  store_round_trip_test(
+    "Mixed Source Round Trip",
+    "struct Vector {\n  int x;\n  int y;\n};\n\n"
+    "static int vector_dot(struct Vector* a, struct Vector* b) {\n"
+    "  return a->x * b->x + a->y * b->y;\n"
+    "}\n"
+    "int values[0x10] = { 0, 017, 0xFFul, 42u, 7ll, 18446744073709551615ull };\n"
+  );
+
+  char   source[64 * 1024];
+  size_t length = 0;
+  for (uint32_t i = 0; length + 64 < sizeof(source); ++i) {
+    length += (size_t)snprintf(source + length, sizeof(source) - length, "%*sfield_%u = %u;%s", (int)(i % 7), "", i % 37, i * 7919u, i % 3 ? " " : "\n\n");
+  }
+  store_round_trip_test("Multi Block Round Trip", source);
+
+  return 0;
+}